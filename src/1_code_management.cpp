@@ -1,19 +1,56 @@
 #include "1_code_management.hpp"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <functional>
 //------------------------------------------------------------------
 namespace code_management {
 
+/// constructor computes where each line begins
+CodeManager::CodeManager(std::span<const std::string_view> sourceCode) : sourceCode(sourceCode) {
+    lineBegins.reserve(sourceCode.size());
+    size_t offset = 0;
+    for(std::string_view line : sourceCode) {
+        lineBegins.push_back(offset);
+        offset += line.size() + 1;
+    }
+}
+
 /// helper function to print error messages
-void CodeFragment::print(std::string_view message) const {
-    std::cout << codeMarker.line << ":" << codeMarker.charBegin << ": " << message << "\n"
-              << "\t" << lineOfCode << "\n"
-              << "\t" << consoleMarking() << std::endl;
+void CodeManager::print(CodeFragment codeFragment, std::string_view message) const {
+    print(codeFragment, message, std::cout);
+}
+
+/// prints error message into the given stream
+void CodeManager::print(CodeFragment codeFragment, std::string_view message, std::ostream& out) const {
+    if(sourceCode.empty() || !codeFragment.hasLocation()) {
+        out << message << "\n";
+        return;
+    }
+    CodeMarker codeMarker = resolve(codeFragment);
+    out << codeMarker.line << ":" << codeMarker.charBegin << ": " << message << "\n"
+        << "\t" << sourceCode[codeMarker.line] << "\n"
+        << "\t" << consoleMarking(codeMarker) << "\n";
+}
+
+/// gives back empty CodeFragment behind the last char
+CodeFragment CodeManager::endOfCode() const {
+    if(sourceCode.empty()) {
+        return {};
+    }
+    return {static_cast<uint32_t>(lineBegins.back() + sourceCode.back().size()), 0};
+}
+
+/// prints all errors with context of the code
+void Diagnostics::render(const CodeManager& codeManager, std::ostream& out) const {
+    for(const Diagnostic& diagnostic : diagnostics) {
+        codeManager.print(diagnostic.codeFragment, diagnostic.message, out);
+    }
 }
 
 /// marks the code fragment in the console
-std::string CodeFragment::consoleMarking() const {
+std::string CodeManager::consoleMarking(const CodeMarker& codeMarker) {
     std::stringstream ss;
     for(unsigned i = 0; i < codeMarker.charBegin; i++) {
         ss << " ";
@@ -32,33 +69,69 @@ bool CodeMarker::operator==(const CodeMarker& other) const {
 }
 
 /// get code string
-std::string_view CodeFragment::getString() const {
-    return lineOfCode.substr(codeMarker.charBegin, codeMarker.charEnd - codeMarker.charBegin + 1);
+std::string_view CodeManager::getString(CodeFragment codeFragment) const {
+    CodeMarker codeMarker = resolve(codeFragment);
+    return sourceCode[codeMarker.line].substr(codeMarker.charBegin, codeFragment.length);
 }
 
 /// gives back CodeMarker
-CodeMarker CodeFragment::resolve() const {
-    return codeMarker;
+CodeMarker CodeManager::resolve(CodeFragment codeFragment) const {
+    // first line which begins after the offset, the fragment is in the line before
+    auto next = std::upper_bound(lineBegins.begin(), lineBegins.end(), codeFragment.offset);
+    size_t line = (next - lineBegins.begin()) - 1;
+    size_t charBegin = codeFragment.offset - lineBegins[line];
+    size_t charEnd = codeFragment.length == 0 ? charBegin : charBegin + codeFragment.length - 1;
+    return {line, charBegin, charEnd};
 }
 
-
 /// gives back CodeFragment
-CodeFragment CodeManager::createCodeFragment(size_t line, size_t charBegin, size_t charEnd) {
-    return {line, charBegin, charEnd, sourceCode[line]};
+CodeFragment CodeManager::createCodeFragment(size_t line, size_t charBegin, size_t charEnd) const {
+    return {static_cast<uint32_t>(lineBegins[line] + charBegin), static_cast<uint32_t>(charEnd - charBegin + 1)};
 }
 
 /// gives back CodeFragment
-CodeFragment CodeManager::createCodeFragment(size_t line, size_t charBegin) {
-    return {line, charBegin, charBegin, sourceCode[line]};
+CodeFragment CodeManager::createCodeFragment(size_t line, size_t charBegin) const {
+    return createCodeFragment(line, charBegin, charBegin);
+}
+
+/// gives back id of name, equal names get the same id
+unsigned NamePool::intern(std::string_view name) {
+    unsigned shardIndex = std::hash<std::string_view>{}(name) & (shardCount - 1);
+    Shard& shard = shards[shardIndex];
+    {
+        // most names are already known, they only need the shared lock
+        std::shared_lock lock(shard.mutex);
+        auto it = shard.ids.find(name);
+        if(it != shard.ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock lock(shard.mutex);
+    // another thread might have added it in the meantime
+    auto it = shard.ids.find(name);
+    if(it != shard.ids.end()) {
+        return it->second;
+    }
+    unsigned id = static_cast<unsigned>(shard.names.size()) << shardBits | shardIndex;
+    shard.ids.emplace(shard.names.emplace_back(name), id);
+    return id;
+}
+
+/// gives back name of id
+std::string_view NamePool::getName(unsigned id) const {
+    const Shard& shard = shards[id & (shardCount - 1)];
+    std::shared_lock lock(shard.mutex);
+    return shard.names[id >> shardBits];
 }
 
-/// copy assignment
-CodeFragment& CodeFragment::operator=(const CodeFragment& other) {
-    if(this != &other) {
-        codeMarker = other.codeMarker;
-        lineOfCode = other.lineOfCode;
+/// number of different names
+size_t NamePool::size() const {
+    size_t size = 0;
+    for(const Shard& shard : shards) {
+        std::shared_lock lock(shard.mutex);
+        size += shard.names.size();
     }
-    return *this;
+    return size;
 }
 
 } // namespace code_management
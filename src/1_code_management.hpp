@@ -2,6 +2,15 @@
 #define H_1_code_management
 #include <string_view>
 #include <span>
+#include <vector>
+#include <cstdint>
+#include <iosfwd>
+#include <array>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 //-------------------------------------------------------------------------------------------------
 namespace code_management {
 
@@ -20,51 +29,106 @@ struct CodeMarker {
     bool operator==(const CodeMarker& other) const;
 };
 
-class CodeManager;
-
-/// saves line range
+/// packed handle for a range of the source code (offset + length)
+/// only gets resolved to line and char by the CodeManager, e.g. when printing
 class CodeFragment {
-    /// marks the code fragment in the console
-    std::string consoleMarking() const;
     public:
-    /// member variables to save positions
-    CodeMarker codeMarker;
-    /// saves the line of code
-    std::string_view lineOfCode;
+    /// offset of the first char, counted over all lines (each line break counts as one char)
+    uint32_t offset;
+    /// number of chars
+    uint32_t length;
     /// default constructor
-    CodeFragment() = default;
-    /// constructor for single position
-    CodeFragment(size_t line, size_t charBegin, std::string_view lineOfCode)
-        : codeMarker(line, charBegin), lineOfCode(lineOfCode) {}
-    /// constructor for range
-    CodeFragment(size_t line, size_t charBegin, size_t charEnd, std::string_view lineOfCode)
-        : codeMarker(line, charBegin, charEnd), lineOfCode(lineOfCode) {}
-    /// copy assignment
-    CodeFragment& operator=(const CodeFragment& other);
-    /// copy constructor
-    CodeFragment(const CodeFragment& other) = default;
-    //CodeFragment(const CodeFragment& other) : codeMarker(other.codeMarker), lineOfCode(other.lineOfCode) {}
-    /// prints context of message with corresponding code fragment
-    void print(std::string_view message) const;
-    /// get code string
-    std::string_view getString() const;
-    /// gives back CodeMarker
-    CodeMarker resolve() const;
+    CodeFragment() : offset(0), length(0) {}
+    /// constructor
+    CodeFragment(uint32_t offset, uint32_t length) : offset(offset), length(length) {}
+    /// fragment of errors which have no place in the code, e.g. about names passed by the caller
+    static CodeFragment none() { return {UINT32_MAX, 0}; }
+    /// false for none()
+    bool hasLocation() const { return offset != UINT32_MAX; }
+    /// comparison operator
+    bool operator==(const CodeFragment& other) const = default;
 };
+static_assert(sizeof(CodeFragment) == 8, "CodeFragment should fit into one register");
 
-/// saves ref to source code + creation of CodeFragments
+/// saves ref to source code + creation and resolution of CodeFragments
 class CodeManager {
-    friend CodeFragment;
+    private:
+    /// offset of the first char of each line
+    std::vector<size_t> lineBegins;
+    /// marks the code fragment in the console
+    static std::string consoleMarking(const CodeMarker& codeMarker);
     public:
     /// ref to source code
-    std::span<std::string_view> sourceCode;
+    std::span<const std::string_view> sourceCode;
     /// constructor
-    CodeManager(std::span<std::string_view> sourceCode) : sourceCode(sourceCode) {}
+    CodeManager(std::span<const std::string_view> sourceCode);
     /// gives back CodeFragment
-    CodeFragment createCodeFragment(size_t line, size_t charBegin, size_t charEnd);
-    CodeFragment createCodeFragment(size_t line, size_t charBegin);
+    CodeFragment createCodeFragment(size_t line, size_t charBegin, size_t charEnd) const;
+    CodeFragment createCodeFragment(size_t line, size_t charBegin) const;
+    /// get code string of CodeFragment
+    std::string_view getString(CodeFragment codeFragment) const;
+    /// gives back line and chars of CodeFragment
+    CodeMarker resolve(CodeFragment codeFragment) const;
+    /// gives back empty CodeFragment behind the last char, used for errors at the end of the code
+    CodeFragment endOfCode() const;
+    /// prints context of message with corresponding code fragment
+    void print(CodeFragment codeFragment, std::string_view message) const;
+    void print(CodeFragment codeFragment, std::string_view message, std::ostream& out) const;
 };
 
+/// one error found while compiling
+struct Diagnostic {
+    /// where the error was found
+    CodeFragment codeFragment;
+    /// has to be a string literal, diagnostics don't own their messages
+    std::string_view message;
+};
+
+/// buffer for errors supplied by the caller of the compilation steps
+/// reporting only appends to a vector, rendering is done later (or never)
+class Diagnostics {
+    private:
+    std::vector<Diagnostic> diagnostics;
+    public:
+    /// saves error
+    void report(CodeFragment codeFragment, std::string_view message) { diagnostics.push_back({codeFragment, message}); }
+    /// saves error without a place in the code, only the message gets printed
+    void report(std::string_view message) { report(CodeFragment::none(), message); }
+    /// true if any error was reported
+    bool hasErrors() const { return !diagnostics.empty(); }
+    /// gives back all errors in the order they were reported
+    std::span<const Diagnostic> getDiagnostics() const { return diagnostics; }
+    /// drops all errors, the buffer can be reused
+    void clear() { diagnostics.clear(); }
+    /// prints all errors with context of the code
+    void render(const CodeManager& codeManager, std::ostream& out) const;
+};
+
+/// interns names for all functions of a Pljit, so equal names get the same id in every function
+/// names are copied into the pool, their string_views stay valid as long as the pool, independent of the source code
+/// thread safe, names are spread over shards with their own locks
+class NamePool {
+    private:
+    static constexpr unsigned shardBits = 4;
+    static constexpr unsigned shardCount = 1u << shardBits;
+    /// part of the pool with its own lock
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        /// id of each name, keys point into names
+        std::unordered_map<std::string_view, unsigned> ids;
+        /// owns the names, deque doesn't move them when growing
+        std::deque<std::string> names;
+    };
+    std::array<Shard, shardCount> shards;
+    public:
+    /// gives back id of name, equal names get the same id
+    /// the lower bits of the id are the shard, the upper bits the index in the shard
+    unsigned intern(std::string_view name);
+    /// gives back name of id, valid as long as the pool
+    std::string_view getName(unsigned id) const;
+    /// number of different names
+    size_t size() const;
+};
 
 } // namespace code_management
 //-------------------------------------------------------------------------------------------------
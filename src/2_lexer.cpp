@@ -1,22 +1,59 @@
 #include "2_lexer.hpp"
 #include <string_view>
 #include <charconv>
-#include <iostream>
 #include <optional>
 #include <cctype>
+#include <functional>
 //--------------------------------------------------------------
 namespace lexical_analysis {
 
-/// constructor for Literal
-Literal::Literal(CodeFragment& codeFragment)
-    : Token(codeFragment, Type::Literal) {
-    std::string_view stringNumber = codeFragment.getString();
-    auto result = std::from_chars(stringNumber.data(), stringNumber.data() + stringNumber.size(), number);
-    if(result.ec == std::errc::invalid_argument) {
-        std::cout << "is not a number" << std::endl;
+/// gives back id of name, new names get the next free id
+unsigned NameTable::intern(std::string_view name) {
+    size_t hash = std::hash<std::string_view>{}(name);
+    size_t mask = slots.size() - 1;
+    for(size_t slot = hash & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+        unsigned id = slots[slot] - 1;
+        if(hashes[id] == hash && names[id] == name) {
+            return id;
+        }
+    }
+    unsigned id = names.size();
+    names.push_back(name);
+    hashes.push_back(hash);
+    // keep load factor below 1/2
+    if(names.size() * 2 > slots.size()) {
+        grow();
+    } else {
+        size_t slot = hash & mask;
+        while(slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id + 1;
+    }
+    return id;
+}
+
+/// doubles number of slots, inserts all names again
+void NameTable::grow() {
+    slots.assign(slots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for(unsigned id = 0; id < names.size(); id++) {
+        size_t slot = hashes[id] & mask;
+        while(slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id + 1;
     }
 }
 
+/// reports error and stops lexing
+std::unique_ptr<Token> Lexer::fail(CodeFragment codeFragment, std::string_view message) {
+    diagnostics.report(codeFragment, message);
+    failed = true;
+    lexedAll = true;
+    return nullptr;
+}
+
 /// advances position by one char
 /// returns true if it goes to a new line
 bool Lexer::advanceOneChar() {
@@ -38,7 +75,8 @@ bool Lexer::advanceOneChar() {
 void Lexer::firstAdvance() {
     while(!lexedAll) {
         std::string_view currentChar = codeManager.sourceCode[lineNum].substr(charNum, 1);
-        if(currentChar != " " && currentChar != "\n" && currentChar != "\t") {
+        // empty lines get skipped as well
+        if(!currentChar.empty() && currentChar != " " && currentChar != "\n" && currentChar != "\t") {
             return;
         }
         advanceOneChar();
@@ -91,16 +129,17 @@ std::unique_ptr<Token> Lexer::next() {
 
         // parsing token with two chars
     } else if(":" == currentChar) {
-        advanceOneChar();
+        // ":" at the end of a line can't be the beginning of ":="
+        if(advanceOneChar()) {
+            return fail(codeFragment, "error: should be \":=\"");
+        }
         currentChar = codeManager.sourceCode[lineNum].substr(charNum, 1);
         codeFragment = codeManager.createCodeFragment(lineNum, charNum - 1, charNum);
         if("=" == currentChar) {
             advanceOneChar();
             return std::make_unique<Operator>(codeFragment, Operator::Operators::EqualsAssignment);
         } else {
-            codeFragment.print("error: should be \":=\"");
-            advanceOneChar();
-            return nullptr;
+            return fail(codeFragment, "error: should be \":=\"");
         }
     }
 
@@ -120,7 +159,13 @@ std::unique_ptr<Token> Lexer::next() {
         } else {
             codeFragment = codeManager.createCodeFragment(lineNum - 1, beginningChar, codeManager.sourceCode[lineNum-1].size() - 1);
         }
-        return std::make_unique<Literal>(codeFragment);
+        std::string_view numString = codeManager.getString(codeFragment);
+        int64_t number;
+        auto result = std::from_chars(numString.data(), numString.data() + numString.size(), number);
+        if(result.ec != std::errc()) {
+            return fail(codeFragment, "error: literal out of range");
+        }
+        return std::make_unique<Literal>(codeFragment, number);
     }
 
     // if keyword or identifier
@@ -140,7 +185,7 @@ std::unique_ptr<Token> Lexer::next() {
             codeFragment = codeManager.createCodeFragment(lineNum - 1, beginningChar, codeManager.sourceCode[lineNum-1].size() - 1);
         }
         // parsing keywords
-        std::string_view stringOperator = codeFragment.getString();
+        std::string_view stringOperator = codeManager.getString(codeFragment);
         if("PARAM" == stringOperator) {
             return std::make_unique<Keyword>(codeFragment, Keyword::Keywords::PARAM);
         } else if("VAR" == stringOperator) {
@@ -154,11 +199,10 @@ std::unique_ptr<Token> Lexer::next() {
         } else if("RETURN" == stringOperator) {
             return std::make_unique<Keyword>(codeFragment, Keyword::Keywords::RETURN);
         } else {
-            return std::make_unique<Identifier>(codeFragment);
+            return std::make_unique<Identifier>(codeFragment, nameTable.intern(stringOperator));
         }
     }
-    codeFragment.print("error: unknown character");
-    return nullptr;
+    return fail(codeFragment, "error: unknown character");
 }
 
 
@@ -17,16 +17,47 @@ namespace lexical_analysis {
 
 class Token;
 
+/// interns identifier names to dense ids (0, 1, 2, ... in order of first occurrence)
+/// open addressing with linear probing, so each identifier token is hashed once
+class NameTable {
+    private:
+    /// id + 1 of the name in this slot, 0 if empty
+    std::vector<unsigned> slots;
+    /// names by id
+    std::vector<std::string_view> names;
+    /// hashes by id, growing doesn't need to hash the names again
+    std::vector<size_t> hashes;
+    /// doubles number of slots
+    void grow();
+    public:
+    /// constructor
+    NameTable() : slots(16, 0) {}
+    /// gives back id of name, new names get the next free id
+    unsigned intern(std::string_view name);
+    /// gives back name of id
+    std::string_view getName(unsigned id) const { return names[id]; }
+    /// number of different names
+    size_t size() const { return names.size(); }
+};
+
 /// class which does the lexing
 class Lexer {
     private:
     /// manages code fragments
-    CodeManager codeManager;
+    const CodeManager& codeManager;
+    /// collects errors
+    Diagnostics& diagnostics;
     /// member variables to save where the lexer is in the code
     size_t lineNum;
     size_t charNum;
     /// bool if it has lexed everything
     bool lexedAll;
+    /// bool if it stopped because of an error
+    bool failed;
+    /// ids of identifier names
+    NameTable nameTable;
+    /// reports error and stops lexing
+    std::unique_ptr<Token> fail(CodeFragment codeFragment, std::string_view message);
     /// advances position by one char
     bool advanceOneChar();
     /// advance postion until first non-whitespace character
@@ -34,9 +65,15 @@ class Lexer {
 
     public:
     /// constructor
-    Lexer(CodeManager& codeManager) : codeManager(codeManager), lineNum(0), charNum(0), lexedAll(false) {}
+    Lexer(const CodeManager& codeManager, Diagnostics& diagnostics)
+        : codeManager(codeManager), diagnostics(diagnostics), lineNum(0), charNum(0), lexedAll(codeManager.sourceCode.empty()), failed(false) {}
     /// advances Lexer-Algo and determines next token
+    /// gives back nullptr at the end of the code or after an error
     std::unique_ptr<Token> next();
+    /// true if the lexer stopped because of an error
+    bool hasFailed() const { return failed; }
+    /// gives back names of all identifiers lexed so far
+    const NameTable& getNameTable() const { return nameTable; }
 };
 
 
@@ -44,7 +81,7 @@ class Lexer {
 /// Terminal Symbols grouped in Tokens
 class Token {
     public:
-    /// CodeFragment
+    /// position in the source code
     CodeFragment codeFragment;
     /// all possible types of Tokens
     enum class Type {
@@ -57,7 +94,7 @@ class Token {
     /// save derived class
     Type type;
     /// normal constructor
-    Token(CodeFragment& codeFragment, Type type) : codeFragment(codeFragment), type(type) {}
+    Token(CodeFragment codeFragment, Type type) : codeFragment(codeFragment), type(type) {}
     /// default constructor
     Token() {}
     /// destructor
@@ -68,7 +105,7 @@ class Token {
 class Literal : public Token {
     public:
     int64_t number;
-    Literal(CodeFragment& codeFragment);
+    Literal(CodeFragment codeFragment, int64_t number) : Token(codeFragment, Type::Literal), number(number) {}
     /// destructor
     ~Literal() override = default;
 };
@@ -88,7 +125,7 @@ class Operator : public Token {
         BracketsClosed
     };
     /// constructor
-    Operator(CodeFragment& codeFragment, Operators operators) : Token(codeFragment, Token::Type::Operator), operators(operators) {}
+    Operator(CodeFragment codeFragment, Operators operators) : Token(codeFragment, Token::Type::Operator), operators(operators) {}
     /// type of operator
     Operators operators;
     /// destructor
@@ -110,7 +147,7 @@ class Keyword : public Token {
     /// type of Keyword
     Keywords keywords;
     /// Constructor
-    Keyword(CodeFragment& codeFragment, Keywords keywords) : Token(codeFragment, Token::Type::Keyword), keywords(keywords) {}
+    Keyword(CodeFragment codeFragment, Keywords keywords) : Token(codeFragment, Token::Type::Keyword), keywords(keywords) {}
     /// destructor
     ~Keyword() override = default;
 };
@@ -127,7 +164,7 @@ class Separator : public Token {
     /// type of separator
     Separators separators;
     /// constructor
-    Separator(CodeFragment& codeFragment, Separators separators) : Token(codeFragment, Type::Separator), separators(separators) {}
+    Separator(CodeFragment codeFragment, Separators separators) : Token(codeFragment, Type::Separator), separators(separators) {}
     /// destructor
     ~Separator() override = default;
 };
@@ -136,7 +173,9 @@ class Separator : public Token {
 /// identifier token (names which are not keywords)
 class Identifier : public Token {
     public:
-    Identifier(CodeFragment& codeFragment) : Token(codeFragment, Type::Identifier) {}
+    /// id of the name in the NameTable of the lexer
+    unsigned nameId;
+    Identifier(CodeFragment codeFragment, unsigned nameId) : Token(codeFragment, Type::Identifier), nameId(nameId) {}
     /// destructor
     ~Identifier() override = default;
 };
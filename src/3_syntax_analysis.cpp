@@ -1,5 +1,6 @@
 #include "3_syntax_analysis.hpp"
 #include "iostream"
+#include <algorithm>
 //--------------------------------------------------------------
 namespace syntax_analysis {
 
@@ -43,432 +44,536 @@ static Literal* getLiteral(Token* token) {
     }
 }
 
+/// downcasts Token to Identifier
+static Identifier* getIdentifier(Token* token) {
+    switch(token->type) {
+        case Token::Type::Identifier:
+            return static_cast<Identifier*>(token);
+        default:
+            return nullptr;
+    }
+}
+
+/// gives back aligned memory of given size
+void* Arena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    if(current == nullptr || padding + size > remaining) {
+        // start new chunk, chunks are aligned for every node type
+        size_t chunkSize = std::max(nextChunkSize, size);
+        chunks.emplace_back(new std::byte[chunkSize]);
+        current = chunks.back().get();
+        remaining = chunkSize;
+        padding = 0;
+        nextChunkSize = std::min(nextChunkSize * 2, maxChunkSize);
+    }
+    void* result = current + padding;
+    current += padding + size;
+    remaining -= padding + size;
+    return result;
+}
+
 /// get new token if nullpointer
-void SyntaxAnalyser::getToken() {
-    if (!token) {
+/// returns false if there is no token left, the error is already reported then
+bool SyntaxAnalyser::getToken() {
+    if(!token) {
         token_ptr = lexer.next();
         token = token_ptr.get();
+        if(!token) {
+            // lexer reports its own errors
+            if(!lexer.hasFailed()) {
+                diagnostics.report(codeManager.endOfCode(), "error: unexpected end of code");
+            }
+            failed = true;
+            return false;
+        }
     }
+    return true;
 }
 
 /// delete token if used up
 void SyntaxAnalyser::deleteToken() {
-    token = token_ptr.release();
+    token_ptr.reset();
     token = nullptr;
 }
 
+/// reports error at code fragment
+void SyntaxAnalyser::fail(CodeFragment codeFragment, std::string_view message) {
+    diagnostics.report(codeFragment, message);
+    failed = true;
+}
+
 /// parse function-definition
-FunctionDefinition SyntaxAnalyser::parseFunctionDefinition() {
+std::optional<FunctionDefinition> SyntaxAnalyser::parseFunctionDefinition() {
     auto parameters = parseParameterDeclarations();
+    if(failed) {
+        return std::nullopt;
+    }
     auto variables = parseVariableDeclarations();
+    if(failed) {
+        return std::nullopt;
+    }
     auto constants = parseConstantDeclarations();
+    if(failed) {
+        return std::nullopt;
+    }
     auto compoundStatement = parseCompoundStatement();
+    if(!compoundStatement.has_value()) {
+        return std::nullopt;
+    }
     // parse dot
-    getToken();
-    if(token == nullptr) {
-        throw "failure!";
+    if(!getToken()) {
+        return std::nullopt;
     }
     Separator* separator = getSeparator(token);
     // check if token is a point
     if(separator && separator->separators == Separator::Separators::point) {
         TerminalNode dot(separator->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
-        return {std::move(parameters), std::move(variables), std::move(constants), std::move(compoundStatement), std::move(dot)};
+        return std::make_optional<FunctionDefinition>(std::move(parameters), std::move(variables), std::move(constants), std::move(compoundStatement.value()), std::move(dot));
     }
-    token->codeFragment.print("error: point missing");
-    throw "failure!";
+    fail(token->codeFragment, "error: point missing");
+    return std::nullopt;
 }
 
 /// parse parameter-declarations
+/// gives back nullopt if there are none, failed is set if they are invalid
 std::optional<ParameterDeclarations> SyntaxAnalyser::parseParameterDeclarations() {
-    getToken();
+    if(!getToken()) {
+        return std::nullopt;
+    }
     const Keyword* keyword = getKeyword(token);
     // check if token is PARAM
     if(keyword && keyword->keywords == Keyword::Keywords::PARAM) {
         TerminalNode PARAM(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto declaratorList = parseDeclaratorList();
-        getToken();
+        if(!declaratorList.has_value() || !getToken()) {
+            return std::nullopt;
+        }
         Separator* separator = getSeparator(token);
         // check if token is semicolon
         if(separator && separator->separators == Separator::Separators::semicolon) {
             TerminalNode semiColon(token->codeFragment, TerminalNode::Type::Generic);
             deleteToken();
-            return std::make_optional<ParameterDeclarations>(std::move(PARAM), std::move(declaratorList), std::move(semiColon));
+            return std::make_optional<ParameterDeclarations>(std::move(PARAM), std::move(declaratorList.value()), std::move(semiColon));
         } else {
-            token->codeFragment.print("error: semicolon missing");
+            fail(token->codeFragment, "error: semicolon missing");
         }
-    } else {
-        return std::nullopt;
     }
-    throw "failure!";
+    return std::nullopt;
 }
 
 /// parse variable-declarations
+/// gives back nullopt if there are none, failed is set if they are invalid
 std::optional<VariableDeclarations> SyntaxAnalyser::parseVariableDeclarations() {
-    getToken();
+    if(!getToken()) {
+        return std::nullopt;
+    }
     const Keyword* keyword = getKeyword(token);
     // check if token is VAR
     if(keyword && keyword->keywords == Keyword::Keywords::VAR) {
         TerminalNode VAR(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto declaratorList = parseDeclaratorList();
-        getToken();
+        if(!declaratorList.has_value() || !getToken()) {
+            return std::nullopt;
+        }
         Separator* separator = getSeparator(token);
         // check if token is semicolon
         if(separator && separator->separators == Separator::Separators::semicolon) {
             TerminalNode semiColon(token->codeFragment, TerminalNode::Type::Generic);
             deleteToken();
-            return std::make_optional<VariableDeclarations>(VAR, declaratorList, semiColon);
+            return std::make_optional<VariableDeclarations>(VAR, declaratorList.value(), semiColon);
         } else {
-            token->codeFragment.print("error: semicolon missing");
+            fail(token->codeFragment, "error: semicolon missing");
         }
-    } else {
-        return std::nullopt;
     }
-    throw "failure!";
+    return std::nullopt;
 }
 
 /// parse constant-declarations
+/// gives back nullopt if there are none, failed is set if they are invalid
 std::optional<ConstantDeclarations> SyntaxAnalyser::parseConstantDeclarations() {
-    getToken();
+    if(!getToken()) {
+        return std::nullopt;
+    }
     const Keyword* keyword = getKeyword(token);
     // check if token is CONST
     if(keyword && keyword->keywords == Keyword::Keywords::CONST) {
         TerminalNode CONST(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto initDeclaratorList = parseInitDeclaratorList();
-        getToken();
+        if(!initDeclaratorList.has_value() || !getToken()) {
+            return std::nullopt;
+        }
         Separator* separator = getSeparator(token);
         // check if token is semicolon
         if(separator && separator->separators == Separator::Separators::semicolon) {
             TerminalNode semiColon(token->codeFragment, TerminalNode::Type::Generic);
             deleteToken();
-            return std::make_optional<ConstantDeclarations>(std::move(CONST), std::move(initDeclaratorList), std::move(semiColon));
+            return std::make_optional<ConstantDeclarations>(std::move(CONST), std::move(initDeclaratorList.value()), std::move(semiColon));
         } else {
-            token->codeFragment.print("error: semicolon missing");
+            fail(token->codeFragment, "error: semicolon missing");
         }
-    } else {
-        return std::nullopt;
     }
-    throw "failure!";
+    return std::nullopt;
 }
 
 /// parse declarator-list
-DeclaratorList SyntaxAnalyser::parseDeclaratorList() {
-    getToken();
+std::optional<DeclaratorList> SyntaxAnalyser::parseDeclaratorList() {
+    if(!getToken()) {
+        return std::nullopt;
+    }
     // check if token is identifier
     if(token->type == Token::Type::Identifier) {
-        TerminalNode terminalNode(token->codeFragment, TerminalNode::Type::Identifier);
+        TerminalNode terminalNode(*getIdentifier(token));
         deleteToken();
         auto repeating = parseRepeatingDeclaratorList();
-        return {terminalNode, std::move(repeating)};
+        if(failed) {
+            return std::nullopt;
+        }
+        return std::make_optional<DeclaratorList>(terminalNode, repeating);
     } else {
-        token->codeFragment.print("error: expected identifier");
-        throw "failure!";
+        fail(token->codeFragment, "error: expected identifier");
+        return std::nullopt;
     }
-
 }
 
 /// parse repeating part of DeclaratorList
-std::unique_ptr<DeclaratorList::Repeating> SyntaxAnalyser::parseRepeatingDeclaratorList() {
-    getToken();
-    Separator* separator = getSeparator(token);
-    // check if token is comma
-    if(separator && separator->separators == Separator::Separators::comma) {
+/// failed is set if it is invalid
+DeclaratorList::Repeating* SyntaxAnalyser::parseRepeatingDeclaratorList() {
+    DeclaratorList::Repeating* first = nullptr;
+    // where the next element gets linked
+    DeclaratorList::Repeating** last = &first;
+    while(true) {
+        if(!getToken()) {
+            return nullptr;
+        }
+        Separator* separator = getSeparator(token);
+        // check if token is comma
+        if(!separator || separator->separators != Separator::Separators::comma) {
+            return first;
+        }
         TerminalNode colon(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
-        getToken();
+        if(!getToken()) {
+            return nullptr;
+        }
         // check if token is identifier
-        if (token->type == Token::Type::Identifier) {
-            TerminalNode identifier(token->codeFragment, TerminalNode::Type::Identifier);
-            deleteToken();
-            auto repeating = parseRepeatingDeclaratorList();
-            return std::make_unique<DeclaratorList::Repeating>(colon, identifier, std::move(repeating));
-        } else {
-            token->codeFragment.print("error: identifier missing");
-            return {nullptr};
+        if(token->type != Token::Type::Identifier) {
+            fail(token->codeFragment, "error: identifier missing");
+            return nullptr;
         }
-    } else {
-        return {nullptr};
+        TerminalNode identifier(*getIdentifier(token));
+        deleteToken();
+        *last = arena.create<DeclaratorList::Repeating>(colon, identifier, nullptr);
+        last = &(*last)->next;
     }
 }
 
 /// parse init-declarator-list
-InitDeclaratorList SyntaxAnalyser::parseInitDeclaratorList() {
+std::optional<InitDeclaratorList> SyntaxAnalyser::parseInitDeclaratorList() {
     auto initDeclarator = parseInitDeclarator();
+    if(!initDeclarator.has_value()) {
+        return std::nullopt;
+    }
     auto repeating = parseRepeatingInitDeclaratorList();
-    return {initDeclarator, std::move(repeating)};
+    if(failed) {
+        return std::nullopt;
+    }
+    return std::make_optional<InitDeclaratorList>(initDeclarator.value(), repeating);
 }
 
 /// parse repeating part of InitDeclaratorList
-std::unique_ptr<InitDeclaratorList::Repeating> SyntaxAnalyser::parseRepeatingInitDeclaratorList() {
-    getToken();
-    Separator* separator = getSeparator(token);
-    // check is token is comma
-    if(separator && separator->separators == Separator::Separators::comma) {
+/// failed is set if it is invalid
+InitDeclaratorList::Repeating* SyntaxAnalyser::parseRepeatingInitDeclaratorList() {
+    InitDeclaratorList::Repeating* first = nullptr;
+    // where the next element gets linked
+    InitDeclaratorList::Repeating** last = &first;
+    while(true) {
+        if(!getToken()) {
+            return nullptr;
+        }
+        Separator* separator = getSeparator(token);
+        // check is token is comma
+        if(!separator || separator->separators != Separator::Separators::comma) {
+            return first;
+        }
         TerminalNode colon(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto initDeclarator = parseInitDeclarator();
-        auto repeating = parseRepeatingInitDeclaratorList();
-        return std::make_unique<InitDeclaratorList::Repeating>(colon, initDeclarator, std::move(repeating));
-    } else {
-        return {nullptr};
+        if(!initDeclarator.has_value()) {
+            return nullptr;
+        }
+        *last = arena.create<InitDeclaratorList::Repeating>(colon, initDeclarator.value(), nullptr);
+        last = &(*last)->next;
     }
 }
 
 /// parse init-declarator
-InitDeclarator SyntaxAnalyser::parseInitDeclarator() {
-    getToken();
+std::optional<InitDeclarator> SyntaxAnalyser::parseInitDeclarator() {
+    if(!getToken()) {
+        return std::nullopt;
+    }
     // check if token is identifier
-    if(token->type == Token::Type::Identifier) {
-        TerminalNode identifier(token->codeFragment, TerminalNode::Type::Identifier);
-        deleteToken();
-        getToken();
-        Operator* tokenOperator = getOperator(token);
-        // check if token is =
-        if(tokenOperator && tokenOperator->operators == Operator::Operators::EqualsInit) {
-            TerminalNode equals(token->codeFragment, TerminalNode::Type::Generic);
-            deleteToken();
-            getToken();
-            Literal* tokenLiteral = getLiteral(token);
-            // check if token is valid literal
-            if(tokenLiteral) {
-                TerminalNode literal(token->codeFragment, TerminalNode::Type::Literal);
-                deleteToken();
-                return {identifier, equals, literal};
-            } else {
-                token->codeFragment.print("error: expected valid literal");
-            }
-        } else {
-            token->codeFragment.print("error: expected \"=\"");
-        }
-    } else {
-        token->codeFragment.print("error: expected valid identifier");
+    if(token->type != Token::Type::Identifier) {
+        fail(token->codeFragment, "error: expected valid identifier");
+        return std::nullopt;
+    }
+    TerminalNode identifier(*getIdentifier(token));
+    deleteToken();
+    if(!getToken()) {
+        return std::nullopt;
     }
-    throw "failure!";
+    Operator* tokenOperator = getOperator(token);
+    // check if token is =
+    if(!tokenOperator || tokenOperator->operators != Operator::Operators::EqualsInit) {
+        fail(token->codeFragment, "error: expected \"=\"");
+        return std::nullopt;
+    }
+    TerminalNode equals(token->codeFragment, TerminalNode::Type::Generic);
+    deleteToken();
+    if(!getToken()) {
+        return std::nullopt;
+    }
+    // check if token is valid literal
+    if(!getLiteral(token)) {
+        fail(token->codeFragment, "error: expected valid literal");
+        return std::nullopt;
+    }
+    TerminalNode literal(token->codeFragment, TerminalNode::Type::Literal);
+    deleteToken();
+    return std::make_optional<InitDeclarator>(identifier, equals, literal);
 }
 
 /// parse compound-statement
-CompoundStatement SyntaxAnalyser::parseCompoundStatement() {
-    getToken();
+std::optional<CompoundStatement> SyntaxAnalyser::parseCompoundStatement() {
+    if(!getToken()) {
+        return std::nullopt;
+    }
     Keyword* keyword1 = getKeyword(token);
     // check if token is BEGIN
-    if(keyword1 && keyword1->keywords == Keyword::Keywords::BEGIN) {
-        TerminalNode BEGIN(keyword1->codeFragment, TerminalNode::Type::Generic);
-        deleteToken();
-        auto statementList = parseStatementList();
-        getToken();
-        Keyword* keyword2 = getKeyword(token);
-        // check if token is END
-        if(keyword2 && keyword2->keywords == Keyword::Keywords::END) {
-            TerminalNode END(keyword2->codeFragment, TerminalNode::Type::Generic);
-            deleteToken();
-            return {BEGIN, std::move(statementList), END};
-        } else {
-            token->codeFragment.print("error: expected \"END\"");
-        }
-    } else {
-        token->codeFragment.print("error: expected \"BEGIN\"");
+    if(!keyword1 || keyword1->keywords != Keyword::Keywords::BEGIN) {
+        fail(token->codeFragment, "error: expected \"BEGIN\"");
+        return std::nullopt;
     }
-    throw "failure!";
+    TerminalNode BEGIN(keyword1->codeFragment, TerminalNode::Type::Generic);
+    deleteToken();
+    auto statementList = parseStatementList();
+    if(!statementList.has_value() || !getToken()) {
+        return std::nullopt;
+    }
+    Keyword* keyword2 = getKeyword(token);
+    // check if token is END
+    if(!keyword2 || keyword2->keywords != Keyword::Keywords::END) {
+        fail(token->codeFragment, "error: expected \"END\"");
+        return std::nullopt;
+    }
+    TerminalNode END(keyword2->codeFragment, TerminalNode::Type::Generic);
+    deleteToken();
+    return std::make_optional<CompoundStatement>(BEGIN, std::move(statementList.value()), END);
 }
 
 /// parse statement-list
-StatementList SyntaxAnalyser::parseStatementList() {
+std::optional<StatementList> SyntaxAnalyser::parseStatementList() {
     auto statement = parseStatement();
+    if(!statement.has_value()) {
+        return std::nullopt;
+    }
     auto repeating = parseRepeatingStatementList();
-    return {std::move(statement), std::move(repeating)};
+    if(failed) {
+        return std::nullopt;
+    }
+    return std::make_optional<StatementList>(std::move(statement.value()), repeating);
 }
 
 /// parse repeating part of StatementList
-std::unique_ptr<StatementList::Repeating> SyntaxAnalyser::parseRepeatingStatementList() {
-    getToken();
-    Separator* separator = getSeparator(token);
-    // check if token is semicolon
-    if(separator && separator->separators == Separator::Separators::semicolon) {
+/// failed is set if it is invalid
+StatementList::Repeating* SyntaxAnalyser::parseRepeatingStatementList() {
+    StatementList::Repeating* first = nullptr;
+    // where the next statement gets linked
+    StatementList::Repeating** last = &first;
+    while(true) {
+        if(!getToken()) {
+            return nullptr;
+        }
+        Separator* separator = getSeparator(token);
+        // check if token is semicolon
+        if(!separator || separator->separators != Separator::Separators::semicolon) {
+            return first;
+        }
         TerminalNode semiColon(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto statement = parseStatement();
-        auto repeating = parseRepeatingStatementList();
-        return std::make_unique<StatementList::Repeating>(semiColon, std::move(statement), std::move(repeating));
-    } else {
-        return {nullptr};
+        if(!statement.has_value()) {
+            return nullptr;
+        }
+        *last = arena.create<StatementList::Repeating>(semiColon, std::move(statement.value()), nullptr);
+        last = &(*last)->next;
     }
 }
 
 /// parse statement
-Statement SyntaxAnalyser::parseStatement() {
-    getToken();
+std::optional<Statement> SyntaxAnalyser::parseStatement() {
+    if(!getToken()) {
+        return std::nullopt;
+    }
     Keyword* keyword = getKeyword(token);
     // check if token is RETURN, if yes then its a return statement, else it's a normal statement
     if(keyword && keyword->keywords == Keyword::Keywords::RETURN) {
         TerminalNode RETURN(keyword->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
-        auto additiveExpression = parseAdditiveExpression().value();
-        auto returnAdditive = std::make_optional<Statement::ReturnAdditive>(RETURN, additiveExpression);
-        return {Statement::WhichAlternative::ReturnAdditive, std::nullopt, std::move(returnAdditive)};
+        auto additiveExpression = parseAdditiveExpression();
+        if(!additiveExpression.has_value()) {
+            return std::nullopt;
+        }
+        auto returnAdditive = std::make_optional<Statement::ReturnAdditive>(RETURN, additiveExpression.value());
+        return std::make_optional<Statement>(Statement::WhichAlternative::ReturnAdditive, std::nullopt, std::move(returnAdditive));
     } else {
-        auto assignmentExpression = std::make_optional<AssignmentExpression>(parseAssignmentExpression());
-        return {Statement::WhichAlternative::AssignmentExpression, std::move(assignmentExpression), std::nullopt};
+        auto assignmentExpression = parseAssignmentExpression();
+        if(!assignmentExpression.has_value()) {
+            return std::nullopt;
+        }
+        return std::make_optional<Statement>(Statement::WhichAlternative::AssignmentExpression, std::move(assignmentExpression), std::nullopt);
     }
 }
 
 /// parse assignment-expression
-AssignmentExpression SyntaxAnalyser::parseAssignmentExpression() {
-    getToken();
+std::optional<AssignmentExpression> SyntaxAnalyser::parseAssignmentExpression() {
+    if(!getToken()) {
+        return std::nullopt;
+    }
     // check if token is identifier
-    if(token->type == Token::Type::Identifier) {
-        TerminalNode identifier(token->codeFragment, TerminalNode::Type::Identifier);
-        deleteToken();
-        getToken();
-        Operator* operatorToken = getOperator(token);
-        // check if token is :=
-        if(operatorToken && operatorToken->operators == Operator::Operators::EqualsAssignment) {
-            TerminalNode equalsAssignment(operatorToken->codeFragment, TerminalNode::Type::Generic);
-            deleteToken();
-            auto additiveExpression = parseAdditiveExpression().value();
-            return {identifier, equalsAssignment, std::move(additiveExpression)};
-        }
-    } else {
-        token->codeFragment.print("error: expected identifier");
+    if(token->type != Token::Type::Identifier) {
+        fail(token->codeFragment, "error: expected identifier");
+        return std::nullopt;
     }
-    throw "failure!";
+    TerminalNode identifier(*getIdentifier(token));
+    deleteToken();
+    if(!getToken()) {
+        return std::nullopt;
+    }
+    Operator* operatorToken = getOperator(token);
+    // check if token is :=
+    if(!operatorToken || operatorToken->operators != Operator::Operators::EqualsAssignment) {
+        fail(token->codeFragment, "error: expected \":=\"");
+        return std::nullopt;
+    }
+    TerminalNode equalsAssignment(operatorToken->codeFragment, TerminalNode::Type::Generic);
+    deleteToken();
+    auto additiveExpression = parseAdditiveExpression();
+    if(!additiveExpression.has_value()) {
+        return std::nullopt;
+    }
+    return std::make_optional<AssignmentExpression>(identifier, equalsAssignment, std::move(additiveExpression.value()));
 }
 
 /// parse additive-expression
+/// the chain of operands gets linked in a loop, so long sums don't need one stack frame per operand
 std::optional<AdditiveExpression> SyntaxAnalyser::parseAdditiveExpression() {
     auto multiplicativeExpression = parseMultiplicativeExpression();
     if(!multiplicativeExpression.has_value()) {
         return std::nullopt;
     }
-    getToken();
-    auto operator1 = getOperator(token);
-    // check if token is +
-    if(operator1 && operator1->operators == Operator::Operators::Plus) {
-        TerminalNode plus(operator1->codeFragment, TerminalNode::Type::Generic);
-        deleteToken();
-        auto additiveExpression = parseAdditiveExpression();
-        if(!additiveExpression.has_value()) {
-            token->codeFragment.print("error: additiveExpression missing");
-            throw "Failure!";
-        }
-        auto additiveExpression_ptr = std::make_unique<AdditiveExpression>(std::move(additiveExpression.value()));
-        return std::make_optional<AdditiveExpression>(
-            AdditiveExpression::WhichOperator::Plus,
-            std::move(multiplicativeExpression.value()),
-            std::move(plus),
-            std::move(additiveExpression_ptr));
-    // check if token is -
-    } else if (operator1 && operator1->operators == Operator::Operators::Minus) {
-        TerminalNode minus(operator1->codeFragment, TerminalNode::Type::Generic);
+    AdditiveExpression first(AdditiveExpression::WhichOperator::None, std::move(multiplicativeExpression.value()), std::nullopt, nullptr);
+    // last element of the chain, gets the operator and the next element
+    AdditiveExpression* last = &first;
+    while(true) {
+        if(!getToken()) {
+            return std::nullopt;
+        }
+        auto operator1 = getOperator(token);
+        AdditiveExpression::WhichOperator whichOperator;
+        // check if token is + or -
+        if(operator1 && operator1->operators == Operator::Operators::Plus) {
+            whichOperator = AdditiveExpression::WhichOperator::Plus;
+        } else if(operator1 && operator1->operators == Operator::Operators::Minus) {
+            whichOperator = AdditiveExpression::WhichOperator::Minus;
+        } else {
+            // no operator
+            return first;
+        }
+        TerminalNode plusOrMinus(operator1->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
-        auto additiveExpression = parseAdditiveExpression();
-        if(!additiveExpression.has_value()) {
-            token->codeFragment.print("error: additiveExpression missing");
-            throw "Failure!";
-        }
-        auto additiveExpression_ptr = std::make_unique<AdditiveExpression>(std::move(additiveExpression.value()));
-        return std::make_optional<AdditiveExpression>(
-            AdditiveExpression::WhichOperator::Minus,
-            std::move(multiplicativeExpression.value()),
-            std::move(minus),
-            std::move(additiveExpression_ptr));
-    // no operator
-    } else {
-        auto additiveExpression = parseAdditiveExpression();
-        if(!additiveExpression.has_value()) {
-            return std::make_optional<AdditiveExpression>(
-                AdditiveExpression::WhichOperator::None,
-                std::move(multiplicativeExpression.value()),
-                std::nullopt,
-                nullptr);
-        }
-        auto additiveExpression_ptr = std::make_unique<AdditiveExpression>(std::move(additiveExpression.value()));
-        return std::make_optional<AdditiveExpression>(
+        auto nextMultiplicativeExpression = parseMultiplicativeExpression();
+        if(!nextMultiplicativeExpression.has_value()) {
+            return std::nullopt;
+        }
+        auto additiveExpression_ptr = arena.create<AdditiveExpression>(
             AdditiveExpression::WhichOperator::None,
-            std::move(multiplicativeExpression.value()),
+            std::move(nextMultiplicativeExpression.value()),
             std::nullopt,
-            std::move(additiveExpression_ptr));
+            nullptr);
+        last->whichOperator = whichOperator;
+        last->plusOrMinus = plusOrMinus;
+        last->additiveExpression = additiveExpression_ptr;
+        last = additiveExpression_ptr;
     }
 }
 
 /// parse multiplicative-expression
+/// the chain of operands gets linked in a loop, so long products don't need one stack frame per operand
 std::optional<MultiplicativeExpression> SyntaxAnalyser::parseMultiplicativeExpression() {
     auto unaryExpression = parseUnaryExpression();
     if(!unaryExpression.has_value()) {
         return std::nullopt;
     }
-    getToken();
-    auto operator1 = getOperator(token);
-    // check if token is *
-    if(operator1 && operator1->operators == Operator::Operators::Multiplication) {
-        TerminalNode multiply(operator1->codeFragment, TerminalNode::Type::Generic);
-        deleteToken();
-        auto multiplicativeExpression = parseMultiplicativeExpression();
-        if(!multiplicativeExpression.has_value()) {
-            token->codeFragment.print("error: multiplicativeExpression missing");
-            throw "failure!";
-        }
-        auto multiplicativeExpression_ptr = std::make_unique<MultiplicativeExpression>(std::move(multiplicativeExpression.value()));
-        return std::make_optional<MultiplicativeExpression>(
-            MultiplicativeExpression::WhichOperator::Multiplication,
-            std::move(unaryExpression.value()),
-            std::move(multiply),
-            std::move(multiplicativeExpression_ptr));
-    // check if token is /
-    } else if(operator1 && operator1->operators == Operator::Operators::Division) {
-        TerminalNode divide(operator1->codeFragment, TerminalNode::Type::Generic);
+    MultiplicativeExpression first(MultiplicativeExpression::WhichOperator::None, std::move(unaryExpression.value()), std::nullopt, nullptr);
+    // last element of the chain, gets the operator and the next element
+    MultiplicativeExpression* last = &first;
+    while(true) {
+        if(!getToken()) {
+            return std::nullopt;
+        }
+        auto operator1 = getOperator(token);
+        MultiplicativeExpression::WhichOperator whichOperator;
+        // check if token is * or /
+        if(operator1 && operator1->operators == Operator::Operators::Multiplication) {
+            whichOperator = MultiplicativeExpression::WhichOperator::Multiplication;
+        } else if(operator1 && operator1->operators == Operator::Operators::Division) {
+            whichOperator = MultiplicativeExpression::WhichOperator::Divide;
+        } else {
+            // no operator
+            return first;
+        }
+        TerminalNode timesOrDivide(operator1->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
-        auto multiplicativeExpression = parseMultiplicativeExpression();
-        if(!multiplicativeExpression.has_value()) {
-            token->codeFragment.print("error: multiplicativeExpression missing");
-            throw "failure!";
-        }
-        auto multiplicativeExpression_ptr = std::make_unique<MultiplicativeExpression>(std::move(multiplicativeExpression.value()));
-        return std::make_optional<MultiplicativeExpression>(
-            MultiplicativeExpression::WhichOperator::Divide,
-            std::move(unaryExpression.value()),
-            std::move(divide),
-            std::move(multiplicativeExpression_ptr));
-    // no operator
-    } else {
-        auto multiplicativeExpression = parseMultiplicativeExpression();
-        if(!multiplicativeExpression.has_value()) {
-            return std::make_optional<MultiplicativeExpression>(
-                MultiplicativeExpression::WhichOperator::None,
-                std::move(unaryExpression.value()),
-                std::nullopt,
-                nullptr);
-        }
-        auto multiplicativeExpression_ptr = std::make_unique<MultiplicativeExpression>(std::move(multiplicativeExpression.value()));
-        return std::make_optional<MultiplicativeExpression>(
+        auto nextUnaryExpression = parseUnaryExpression();
+        if(!nextUnaryExpression.has_value()) {
+            return std::nullopt;
+        }
+        auto multiplicativeExpression_ptr = arena.create<MultiplicativeExpression>(
             MultiplicativeExpression::WhichOperator::None,
-            std::move(unaryExpression.value()),
+            std::move(nextUnaryExpression.value()),
             std::nullopt,
-            std::move(multiplicativeExpression_ptr));
+            nullptr);
+        last->whichOperator = whichOperator;
+        last->timesOrDivide = timesOrDivide;
+        last->multiplicativeExpression = multiplicativeExpression_ptr;
+        last = multiplicativeExpression_ptr;
     }
 }
 
 /// parse unary-expression
 std::optional<UnaryExpression> SyntaxAnalyser::parseUnaryExpression() {
-    getToken();
-    if(token->codeFragment.getString() == "+") {
+    if(!getToken()) {
+        return std::nullopt;
+    }
+    Operator* operator1 = getOperator(token);
+    if(operator1 && operator1->operators == Operator::Operators::Plus) {
         std::optional<TerminalNode> plus = std::make_optional<TerminalNode>(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto primaryExpression = parsePrimaryExpression();
         if(!primaryExpression.has_value()) {
-            plus.value().codeFragment.print("error: primaryExpression missing");
-            throw "failure!";
+            return std::nullopt;
         }
         return std::make_optional<UnaryExpression>(UnaryExpression::WhichOperator::Plus, plus, std::move(primaryExpression.value()));
-    } else if(token->codeFragment.getString() == "-") {
+    } else if(operator1 && operator1->operators == Operator::Operators::Minus) {
         std::optional<TerminalNode> minus = std::make_optional<TerminalNode>(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
         auto primaryExpression = parsePrimaryExpression();
         if (!primaryExpression.has_value()) {
-            minus.value().codeFragment.print("error: primaryExpression missing");
-            throw "failure!";
+            return std::nullopt;
         }
         return std::make_optional<UnaryExpression>(UnaryExpression::WhichOperator::Minus, minus, std::move(primaryExpression.value()));
     // no operator
@@ -479,16 +584,17 @@ std::optional<UnaryExpression> SyntaxAnalyser::parseUnaryExpression() {
         }
         return std::make_optional<UnaryExpression>(UnaryExpression::WhichOperator::NoOperator, std::nullopt, std::move(primaryExpression.value()));
     }
-
-
 }
 
 /// parse primary-expression
 std::optional<PrimaryExpression> SyntaxAnalyser::parsePrimaryExpression() {
-    getToken();
+    if(!getToken()) {
+        return std::nullopt;
+    }
+    Operator* bracket = getOperator(token);
     if(token->type == Token::Type::Identifier) {
         // create TerminalNode
-        TerminalNode terminalNode(token->codeFragment, TerminalNode::Type::Identifier);
+        TerminalNode terminalNode(*getIdentifier(token));
         // insert TerminalNode + WhichAlternative into PrimaryExpression
         deleteToken();
         return std::make_optional<PrimaryExpression>(PrimaryExpression::WhichAlternative::Identifier, terminalNode);
@@ -500,24 +606,29 @@ std::optional<PrimaryExpression> SyntaxAnalyser::parsePrimaryExpression() {
         deleteToken();
         return std::make_optional<PrimaryExpression>(PrimaryExpression::WhichAlternative::Literal, terminalNode);
 
-    } else if(token->codeFragment.getString() == "(") {
+    } else if(bracket && bracket->operators == Operator::Operators::BracketsOpen) {
         // create TerminalNodes
         TerminalNode terminalNodeLeft(token->codeFragment, TerminalNode::Type::Generic);
         deleteToken();
-        AdditiveExpression additiveExpression = parseAdditiveExpression().value();
-        std::unique_ptr<AdditiveExpression> ptr = std::make_unique<AdditiveExpression>(std::move(additiveExpression));
-        getToken();
-        if(token->codeFragment.getString() == ")") {
+        auto additiveExpression = parseAdditiveExpression();
+        if(!additiveExpression.has_value() || !getToken()) {
+            return std::nullopt;
+        }
+        AdditiveExpression* ptr = arena.create<AdditiveExpression>(std::move(additiveExpression.value()));
+        bracket = getOperator(token);
+        if(bracket && bracket->operators == Operator::Operators::BracketsClosed) {
             TerminalNode terminalNodeRight(token->codeFragment, TerminalNode::Type::Generic);
             deleteToken();
             // create AdditiveExpressionBrackets
-            PrimaryExpression::AdditiveExpressionBrackets additiveExpressionBrackets(terminalNodeLeft, std::move(ptr), terminalNodeRight);
+            PrimaryExpression::AdditiveExpressionBrackets additiveExpressionBrackets(terminalNodeLeft, ptr, terminalNodeRight);
             // insert AdditiveExpressionBrackets + WhichAlternative into PrimaryExpression
             return std::make_optional<PrimaryExpression>(PrimaryExpression::WhichAlternative::AdditiveExpression, std::move(additiveExpressionBrackets));
 
         } else {
-            token->codeFragment.print("error: missing \")\"");
+            fail(token->codeFragment, "error: missing \")\"");
         }
+    } else {
+        fail(token->codeFragment, "error: expected primary-expression");
     }
     return std::nullopt;
 
@@ -577,16 +688,15 @@ void Print::visit(const ConstantDeclarations& node, unsigned thisId) {
 }
 
 void Print::visit(const DeclaratorList& node, unsigned thisId) {
-    std::cout << maxId++ << " [label = \"" << node.identifier.codeFragment.getString() << "\"]" << std::endl;
+    std::cout << maxId++ << " [label = \"" << codeManager.getString(node.identifier.codeFragment) << "\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
-    visit(node.repeating.get(), thisId);
+    visit(node.repeating, thisId);
 }
 
 void Print::visit(const DeclaratorList::Repeating* node, unsigned thisId) {
-    if(node != nullptr) {
-        std::cout << maxId++ << " [label = \"" << node->identifier.codeFragment.getString() << "\"]" << std::endl;
+    for(; node != nullptr; node = node->next) {
+        std::cout << maxId++ << " [label = \"" << codeManager.getString(node->identifier.codeFragment) << "\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(node->next.get(), thisId);
     }
 }
 
@@ -594,21 +704,21 @@ void Print::visit(const InitDeclaratorList& node, unsigned thisId) {
     std::cout << maxId++ << " [label = \"initDeclarator\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
     visit(node.initDeclarator, maxId - 1);
-    visit(node.repeating.get(), thisId);
+    visit(node.repeating, thisId);
 }
 
 void Print::visit(const InitDeclaratorList::Repeating* node, unsigned thisId) {
-    if(node != nullptr) {
+    for(; node != nullptr; node = node->next) {
         std::cout << maxId++ << " [label = \"initDeclarator\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(node->next.get(), thisId);
+        visit(node->initDeclarator, maxId - 1);
     }
 }
 
 void Print::visit(const InitDeclarator& node, unsigned thisId) {
-    std::cout << maxId++ << " [label = \"" << node.identifier.codeFragment.getString() << "\"]" << std::endl;
+    std::cout << maxId++ << " [label = \"" << codeManager.getString(node.identifier.codeFragment) << "\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
-    std::cout << maxId++ << " [label = \"" << node.literal.codeFragment.getString() << "\"]" << std::endl;
+    std::cout << maxId++ << " [label = \"" << codeManager.getString(node.literal.codeFragment) << "\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
 }
 
@@ -624,15 +734,14 @@ void Print::visit(const StatementList& node, unsigned thisId) {
     std::cout << maxId++ << " [label = \"statement0\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
     visit(node.statement, maxId - 1);
-    visit(node.repeating.get(), thisId, 1);
+    visit(node.repeating, thisId, 1);
 }
 
 void Print::visit(const StatementList::Repeating* node, unsigned thisId, unsigned statementId) {
-    if(node != nullptr) {
-        std::cout << maxId++ << " [label = \"statement" << statementId << "\"]" << std::endl;
+    for(; node != nullptr; node = node->next) {
+        std::cout << maxId++ << " [label = \"statement" << statementId++ << "\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
         visit(node->statement, maxId - 1);
-        visit(node->next.get(), thisId, statementId + 1);
     }
 }
 
@@ -651,7 +760,7 @@ void Print::visit(const Statement& node, unsigned thisId) {
 }
 
 void Print::visit(const AssignmentExpression& node, unsigned thisId) {
-    std::cout << maxId++ << " [label = \"" << node.identifier.codeFragment.getString() << "\"]" << std::endl;
+    std::cout << maxId++ << " [label = \"" << codeManager.getString(node.identifier.codeFragment) << "\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
     std::cout << maxId++ << " [label = \"additiveExpression\"]" << std::endl;
     std::cout << thisId << " -> " << maxId - 1 << std::endl;
@@ -659,40 +768,36 @@ void Print::visit(const AssignmentExpression& node, unsigned thisId) {
 }
 
 void Print::visit(const AdditiveExpression& node, unsigned thisId) {
-    std::cout << maxId++ << " [label = \"multiplicativeExpression\"]" << std::endl;
-    std::cout << thisId << " -> " << maxId - 1 << std::endl;
-    visit(node.multiplicativeExpression, maxId - 1);
-    if(node.whichOperator == AdditiveExpression::WhichOperator::Plus) {
-        std::cout << maxId++ << " [label = \"+\"]" << std::endl;
-        std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        std::cout << maxId++ << " [label = \"additiveExpression\"]" << std::endl;
+    // each element of the chain is child of the previous element
+    for(const AdditiveExpression* current = &node; current != nullptr; current = current->additiveExpression) {
+        std::cout << maxId++ << " [label = \"multiplicativeExpression\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(*node.additiveExpression, maxId - 1);
-    } else if(node.whichOperator == AdditiveExpression::WhichOperator::Minus) {
-        std::cout << maxId++ << " [label = \"-\"]" << std::endl;
+        visit(current->multiplicativeExpression, maxId - 1);
+        if(current->whichOperator == AdditiveExpression::WhichOperator::None) {
+            break;
+        }
+        std::cout << maxId++ << " [label = \"" << (current->whichOperator == AdditiveExpression::WhichOperator::Plus ? "+" : "-") << "\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
         std::cout << maxId++ << " [label = \"additiveExpression\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(*node.additiveExpression, maxId - 1);
+        thisId = maxId - 1;
     }
 }
 
 void Print::visit(const MultiplicativeExpression& node, unsigned thisId) {
-    std::cout << maxId++ << " [label = \"unaryExpression\"]" << std::endl;
-    std::cout << thisId << " -> " << maxId - 1 << std::endl;
-    visit(node.unaryExpression, maxId - 1);
-    if(node.whichOperator == MultiplicativeExpression::WhichOperator::Multiplication) {
-        std::cout << maxId++ << " [label = \"*\"]" << std::endl;
+    // each element of the chain is child of the previous element
+    for(const MultiplicativeExpression* current = &node; current != nullptr; current = current->multiplicativeExpression) {
+        std::cout << maxId++ << " [label = \"unaryExpression\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        std::cout << maxId++ << " [label = \"multiplicativeExpression\"]" << std::endl;
-        std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(*node.multiplicativeExpression, maxId - 1);
-    } else if(node.whichOperator == MultiplicativeExpression::WhichOperator::Divide) {
-        std::cout << maxId++ << " [label = \"/\"]" << std::endl;
+        visit(current->unaryExpression, maxId - 1);
+        if(current->whichOperator == MultiplicativeExpression::WhichOperator::None) {
+            break;
+        }
+        std::cout << maxId++ << " [label = \"" << (current->whichOperator == MultiplicativeExpression::WhichOperator::Multiplication ? "*" : "/") << "\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
         std::cout << maxId++ << " [label = \"multiplicativeExpression\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(*node.multiplicativeExpression, maxId - 1);
+        thisId = maxId - 1;
     }
 }
 
@@ -718,7 +823,7 @@ void Print::visit(const UnaryExpression& node, unsigned thisId) {
 void Print::visit(const PrimaryExpression& node, unsigned thisId) {
     if(node.whichAlternative == PrimaryExpression::WhichAlternative::Literal
         || node.whichAlternative == PrimaryExpression::WhichAlternative::Identifier) {
-        std::cout << maxId++ << " [label = \"" << node.terminalNode.value().codeFragment.getString() << "\"]" << std::endl;
+        std::cout << maxId++ << " [label = \"" << codeManager.getString(node.terminalNode.value().codeFragment) << "\"]" << std::endl;
         std::cout << thisId << " -> " << maxId - 1 << std::endl;
     } else {
         // additiveExpression
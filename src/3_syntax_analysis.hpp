@@ -5,6 +5,9 @@
 #include <optional>
 #include <vector>
 #include <memory>
+#include <cstddef>
+#include <type_traits>
+#include <new>
 //--------------------------------------------------------------
 
 using namespace code_management;
@@ -22,8 +25,39 @@ namespace syntax_analysis {
  * if alternation then also store which alternative it represents as additional data member --> optional + enum which says which alternative gets used
  * if optional --> optional-data-struct []
  * if repeating --> linked list of struct for repeating part {}
+ * all nodes behind pointers live in the Arena of the SyntaxAnalyser which created them
  */
 
+/// bump allocator for the nodes of one parse tree, frees all nodes at once when destroyed
+class Arena {
+    private:
+    /// size of the first chunk, following chunks double in size up to maxChunkSize
+    static constexpr size_t firstChunkSize = 1024;
+    static constexpr size_t maxChunkSize = 64 * 1024;
+    /// all chunks allocated so far
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+    /// free part of the current chunk
+    std::byte* current = nullptr;
+    size_t remaining = 0;
+    size_t nextChunkSize = firstChunkSize;
+    /// gives back aligned memory of given size
+    void* allocate(size_t size, size_t alignment);
+    public:
+    /// default constructor
+    Arena() = default;
+    /// arena owns the nodes, so it can't be copied
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    /// move constructor
+    Arena(Arena&&) = default;
+    /// creates node in the arena, destructors are never called
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena never calls destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+};
+
 /// each grammar component has a special class
 // Beginning: Grammar Components
 //--------------------------------------------------------------------
@@ -40,10 +74,14 @@ class TerminalNode {
         Generic // (Operator, Keyword, Separator)
     };
     Type type;
+    /// id of the name in the NameTable of the lexer, only used by identifiers
+    unsigned nameId = 0;
     /// default constructor
     TerminalNode() : type(Type::Generic) {}
     /// Constructor
-    explicit TerminalNode(CodeFragment& codeFragment, Type type) : codeFragment(codeFragment), type(type) {}
+    explicit TerminalNode(CodeFragment codeFragment, Type type) : codeFragment(codeFragment), type(type) {}
+    /// Constructor for identifiers
+    explicit TerminalNode(const lexical_analysis::Identifier& identifier) : codeFragment(identifier.codeFragment), type(Type::Identifier), nameId(identifier.nameId) {}
 };
 
 class AdditiveExpression;
@@ -58,11 +96,11 @@ class PrimaryExpression {
     /// struct which saves brackets + AdditiveExpression
     struct AdditiveExpressionBrackets {
         TerminalNode leftBracket;
-        std::unique_ptr<AdditiveExpression> additiveExpression;
+        AdditiveExpression* additiveExpression;
         TerminalNode rightBracket;
         /// constructor
-        AdditiveExpressionBrackets(TerminalNode& leftBracket, std::unique_ptr<AdditiveExpression> additiveExpression, TerminalNode& rightBracket)
-            : leftBracket(leftBracket), additiveExpression(std::move(additiveExpression)), rightBracket(rightBracket) {}
+        AdditiveExpressionBrackets(TerminalNode& leftBracket, AdditiveExpression* additiveExpression, TerminalNode& rightBracket)
+            : leftBracket(leftBracket), additiveExpression(additiveExpression), rightBracket(rightBracket) {}
     };
     /// says which alternative is used
     WhichAlternative whichAlternative;
@@ -104,14 +142,14 @@ class MultiplicativeExpression {
     WhichOperator whichOperator;
     UnaryExpression unaryExpression;
     std::optional<TerminalNode> timesOrDivide;
-    std::unique_ptr<MultiplicativeExpression> multiplicativeExpression;
+    MultiplicativeExpression* multiplicativeExpression;
     /// constructor
     MultiplicativeExpression(WhichOperator whichOperator,
                              UnaryExpression unaryExpression,
                              std::optional<TerminalNode> timesOrDivide,
-                             std::unique_ptr<MultiplicativeExpression> multiplicativeExpression)
+                             MultiplicativeExpression* multiplicativeExpression)
         : whichOperator(whichOperator), unaryExpression(std::move(unaryExpression)),
-          timesOrDivide(std::move(timesOrDivide)), multiplicativeExpression(std::move(multiplicativeExpression)) {}
+          timesOrDivide(std::move(timesOrDivide)), multiplicativeExpression(multiplicativeExpression) {}
 };
 
 class AdditiveExpression  {
@@ -125,14 +163,14 @@ class AdditiveExpression  {
     WhichOperator whichOperator;
     MultiplicativeExpression multiplicativeExpression;
     std::optional<TerminalNode> plusOrMinus;
-    std::unique_ptr<AdditiveExpression> additiveExpression;
+    AdditiveExpression* additiveExpression;
     /// constructor
     AdditiveExpression(WhichOperator whichOperator,
                        MultiplicativeExpression multiplicativeExpression,
                        std::optional<TerminalNode> plusOrMinus,
-                       std::unique_ptr<AdditiveExpression> additiveExpression)
+                       AdditiveExpression* additiveExpression)
         : whichOperator(whichOperator), multiplicativeExpression(std::move(multiplicativeExpression)),
-          plusOrMinus(std::move(plusOrMinus)), additiveExpression(std::move(additiveExpression)) {}
+          plusOrMinus(std::move(plusOrMinus)), additiveExpression(additiveExpression) {}
 };
 
 class AssignmentExpression  {
@@ -179,18 +217,18 @@ class StatementList {
     struct Repeating {
         TerminalNode semiColon;
         Statement statement;
-        std::unique_ptr<Repeating> next;
+        Repeating* next;
         /// constructor
         Repeating(TerminalNode semiColon,
                   Statement statement,
-                  std::unique_ptr<Repeating> next)
-            : semiColon(std::move(semiColon)), statement(std::move(statement)), next(std::move(next)) {}
+                  Repeating* next)
+            : semiColon(std::move(semiColon)), statement(std::move(statement)), next(next) {}
     };
     Statement statement;
-    std::unique_ptr<Repeating> repeating;
+    Repeating* repeating;
     /// constructor
-    StatementList(Statement statement, std::unique_ptr<Repeating> repeating)
-        : statement(std::move(statement)), repeating(std::move(repeating)) {}
+    StatementList(Statement statement, Repeating* repeating)
+        : statement(std::move(statement)), repeating(repeating) {}
 };
 
 class CompoundStatement {
@@ -221,16 +259,16 @@ class InitDeclaratorList {
     struct Repeating {
         TerminalNode colon;
         InitDeclarator initDeclarator;
-        std::unique_ptr<Repeating> next;
+        Repeating* next;
         /// constructor
-        Repeating(TerminalNode colon, InitDeclarator initDeclarator, std::unique_ptr<Repeating> next)
-            : colon(std::move(colon)), initDeclarator(std::move(initDeclarator)), next(std::move(next)) {}
+        Repeating(TerminalNode colon, InitDeclarator initDeclarator, Repeating* next)
+            : colon(std::move(colon)), initDeclarator(std::move(initDeclarator)), next(next) {}
     };
     InitDeclarator initDeclarator;
-    std::unique_ptr<Repeating> repeating;
+    Repeating* repeating;
     /// constructor
-    InitDeclaratorList(InitDeclarator initDeclarator, std::unique_ptr<Repeating> repeating)
-        : initDeclarator(std::move(initDeclarator)), repeating(std::move(repeating)) {}
+    InitDeclaratorList(InitDeclarator initDeclarator, Repeating* repeating)
+        : initDeclarator(std::move(initDeclarator)), repeating(repeating) {}
 };
 
 class DeclaratorList {
@@ -240,17 +278,17 @@ class DeclaratorList {
         public:
         TerminalNode colon;
         TerminalNode identifier;
-        std::unique_ptr<Repeating> next;
+        Repeating* next;
         /// constructor
-        Repeating(TerminalNode colon, TerminalNode identifier, std::unique_ptr<Repeating> next)
-            : colon(std::move(colon)), identifier(std::move(identifier)), next(std::move(next)) {}
+        Repeating(TerminalNode colon, TerminalNode identifier, Repeating* next)
+            : colon(std::move(colon)), identifier(std::move(identifier)), next(next) {}
 
     };
     TerminalNode identifier;
-    std::unique_ptr<Repeating> repeating;
+    Repeating* repeating;
     /// constructor
-    DeclaratorList(TerminalNode identifier, std::unique_ptr<Repeating> repeating)
-        : identifier(std::move(identifier)), repeating(std::move(repeating)) {}
+    DeclaratorList(TerminalNode identifier, Repeating* repeating)
+        : identifier(std::move(identifier)), repeating(repeating) {}
 };
 
 class ConstantDeclarations {
@@ -311,23 +349,35 @@ class FunctionDefinition {
 // End: Grammar Components
 
 /// creates Syntax Tree based on grammar
+/// errors get reported to the Diagnostics, the parse functions give back nullopt/nullptr then
 class SyntaxAnalyser {
     private:
     /// creates CodeFragments and saves ref to sourceCode
-    CodeManager codeManager;
+    const CodeManager& codeManager;
+    /// collects errors
+    Diagnostics& diagnostics;
     Lexer lexer;
     std::unique_ptr<Token> token_ptr;
     Token* token;
+    /// bool if an error was reported
+    bool failed;
+    /// owns all nodes of the parse tree
+    Arena arena;
     public:
     /// Constructor
-    SyntaxAnalyser(CodeManager& codeManager) : codeManager(codeManager), lexer(codeManager), token_ptr(nullptr), token(nullptr) {}
-    /// parse function-definition
-    FunctionDefinition parseFunctionDefinition();
+    SyntaxAnalyser(const CodeManager& codeManager, Diagnostics& diagnostics)
+        : codeManager(codeManager), diagnostics(diagnostics), lexer(codeManager, diagnostics), token_ptr(nullptr), token(nullptr), failed(false) {}
+    /// parse function-definition, gives back nullopt if the code is invalid
+    std::optional<FunctionDefinition> parseFunctionDefinition();
+    /// gives back names of the identifiers
+    const lexical_analysis::NameTable& getNameTable() const { return lexer.getNameTable(); }
     private:
-    /// get new token if nullpointer
-    void getToken();
+    /// get new token if nullpointer, gives back false at the end of the code
+    bool getToken();
     /// delete token if used up
     void deleteToken();
+    /// reports error at code fragment
+    void fail(CodeFragment codeFragment, std::string_view message);
     /// parse parameter-declarations
     std::optional<ParameterDeclarations> parseParameterDeclarations();
     /// parse variable-declarations
@@ -335,25 +385,25 @@ class SyntaxAnalyser {
     /// parse constant-declarations
     std::optional<ConstantDeclarations> parseConstantDeclarations();
     /// parse declarator-list
-    DeclaratorList parseDeclaratorList();
+    std::optional<DeclaratorList> parseDeclaratorList();
     /// parse repeating part of DeclaratorList
-    std::unique_ptr<DeclaratorList::Repeating> parseRepeatingDeclaratorList();
+    DeclaratorList::Repeating* parseRepeatingDeclaratorList();
     /// parse init-declarator-list
-    InitDeclaratorList parseInitDeclaratorList();
+    std::optional<InitDeclaratorList> parseInitDeclaratorList();
     /// parse repeating part of InitDeclaratorList
-    std::unique_ptr<InitDeclaratorList::Repeating> parseRepeatingInitDeclaratorList();
+    InitDeclaratorList::Repeating* parseRepeatingInitDeclaratorList();
     /// parse init-declarator
-    InitDeclarator parseInitDeclarator();
+    std::optional<InitDeclarator> parseInitDeclarator();
     /// parse compound-statement
-    CompoundStatement parseCompoundStatement();
+    std::optional<CompoundStatement> parseCompoundStatement();
     /// parse statement-list
-    StatementList parseStatementList();
+    std::optional<StatementList> parseStatementList();
     /// parse repeating part of StatementList
-    std::unique_ptr<StatementList::Repeating> parseRepeatingStatementList();
+    StatementList::Repeating* parseRepeatingStatementList();
     /// parse statement
-    Statement parseStatement();
+    std::optional<Statement> parseStatement();
     /// parse assignment-expression
-    AssignmentExpression parseAssignmentExpression();
+    std::optional<AssignmentExpression> parseAssignmentExpression();
     /// parse additive-expression
     std::optional<AdditiveExpression> parseAdditiveExpression();
     /// parse multiplicative-expression
@@ -371,7 +421,11 @@ class Print {
     private:
     /// unique id for nodes
     unsigned maxId = 0;
+    /// resolves CodeFragments of TerminalNodes
+    const CodeManager& codeManager;
     public:
+    /// constructor
+    explicit Print(const CodeManager& codeManager) : codeManager(codeManager) {}
     /// visit methods for all node types
     void visit(const FunctionDefinition& node);
     void visit(const ParameterDeclarations& node, unsigned thisId);
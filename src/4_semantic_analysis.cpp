@@ -2,342 +2,632 @@
 #include "3_syntax_analysis.hpp"
 #include "4_semantic_analysis.hpp"
 #include <string_view>
+#include <cassert>
 #include <charconv>
 #include <iostream>
 #include <optional>
 //--------------------------------------------------------------
 namespace semantic_analysis {
 
-/// downcasts Arithmetic to UnaryOperator
-const UnaryOperator* getUnaryOperator(const Arithmetic* node) {
-    switch(node->type) {
-        case Arithmetic::Type::UnaryOperator:
-            return static_cast<const UnaryOperator*>(node);
-        default:
-            return nullptr;
-    }
-}
-
-/// downcasts Arithmetic to BinaryOperator
-const BinaryOperator* getBinaryOperator(const Arithmetic* node) {
-    switch(node->type) {
-        case Arithmetic::Type::BinaryOperator:
-            return static_cast<const BinaryOperator*>(node);
-        default:
-            return nullptr;
-    }
-}
-
-
-/// downcasts Arithmetic to Literal
-const semantic_analysis::Literal* getLiteral(const Arithmetic* node) {
-    switch(node->type) {
-        case Arithmetic::Type::Literal:
-            return static_cast<const semantic_analysis::Literal*>(node);
-        default:
-            return nullptr;
-    }
-}
-
-
-/// downcasts Arithmetic to IdentifierNode
-const IdentifierNode* getIdentifier(const Arithmetic* node) {
-    switch(node->type) {
-        case Arithmetic::Type::Identifier:
-            return static_cast<const IdentifierNode*>(node);
-        default:
-            return nullptr;
-    }
-}
-
-
-/// downcasts Statement to NormalStatement
-const NormalStatement* getNormalStatement(const Statement* node) {
-    switch(node->type) {
-        case Statement::Type::NormalStatement:
-            return static_cast<const NormalStatement*>(node);
-        default:
-            return nullptr;
-    }
-}
-
-/// downcasts Statement to ReturnStatement
-const ReturnStatement* getReturnStatement(const Statement* node) {
-    switch(node->type) {
-        case Statement::Type::ReturnStatement:
-            return static_cast<const ReturnStatement*>(node);
-        default:
-            return nullptr;
-    }
-}
-
-
-
-/// converts string to int64_t
+/// converts string to int64_t, the lexer already reported literals which are no int64_t
 int64_t stringToInt(std::string_view numString) {
     int64_t number = 0;
-    auto result = std::from_chars(numString.data(), numString.data() + numString.size(), number);
-    if(result.ec == std::errc::invalid_argument) {
-        std::cout << "is not a number" << std::endl;
-    }
+    [[maybe_unused]] auto result = std::from_chars(numString.data(), numString.data() + numString.size(), number);
+    assert(result.ec == std::errc() && "literal was checked by the lexer");
     return number;
 }
 
-/// constructor for Literal
-Literal::Literal(std::string_view numString) : Arithmetic(Arithmetic::Type::Literal), number(stringToInt(numString)) {}
-
 /// returns false, if identifier with same name already exists
-bool SymbolTable::addIdentifier(code_management::CodeFragment codeFragment, Identifier::Type type) {
-    return addIdentifier(codeFragment, type, 0);
-}
-
-bool SymbolTable::addIdentifier(code_management::CodeFragment codeFragment, Identifier::Type type, int64_t value) {
-    if(hashTable.contains(codeFragment.getString())) {
+bool SymbolTable::addIdentifier(unsigned nameId, std::string_view name, Identifier::Type type, int64_t value) {
+    if(nameId >= idOfName.size()) {
+        idOfName.resize(nameId + 1, undeclared);
+    } else if(idOfName[nameId] != undeclared) {
         return false;
+    }
+    idOfName[nameId] = identifiers.size();
+    if(namePool) {
+        // name stays valid without the source code
+        unsigned sharedNameId = namePool->intern(name);
+        identifiers.emplace_back(namePool->getName(sharedNameId), type, value, static_cast<unsigned>(identifiers.size()), sharedNameId);
     } else {
-        hashTable[codeFragment.getString()] = {codeFragment, type, value, static_cast<unsigned int>(hashTable.size())};
-        return true;
+        identifiers.emplace_back(name, type, value, static_cast<unsigned>(identifiers.size()), nameId);
     }
+    return true;
 }
 
 /// returns nullptr if identifier doesnt exist
-const Identifier* SymbolTable::getIdentifier(std::string_view name) {
-    if(hashTable.contains(name)) {
-        return &hashTable[name];
-    } else {
+const Identifier* SymbolTable::getIdentifier(unsigned nameId) const {
+    if(nameId >= idOfName.size() || idOfName[nameId] == undeclared) {
         return nullptr;
     }
+    return &identifiers[idOfName[nameId]];
+}
+
+/// adds declared identifier to symbolTable, gives back false if the name already exists
+bool SemanticAnalyser::addIdentifier(const syntax_analysis::TerminalNode& identifier, Identifier::Type type, int64_t value) {
+    if(!symbolTable.addIdentifier(identifier.nameId, codeManager.getString(identifier.codeFragment), type, value)) {
+        diagnostics.report(identifier.codeFragment, "error: identifier with the same name already exists!");
+        return false;
+    }
+    return true;
 }
 
-/// returns root of AST
+/// returns root of AST or nullptr if the code is invalid
 std::unique_ptr<Function> SemanticAnalyser::analyseFunction() {
+    // syntax errors are already reported
+    if(!syntaxTree.has_value()) {
+        return nullptr;
+    }
+    const syntax_analysis::FunctionDefinition& functionDefinition = syntaxTree.value();
     /// goes through all names of declarations and adds them to the symbol table
-    if(syntaxTree.parameters.has_value()) {
-        const syntax_analysis::DeclaratorList& declaratorListPar = syntaxTree.parameters.value().declaratorList;
-        if(!symbolTable.addIdentifier(declaratorListPar.identifier.codeFragment, Identifier::Type::Parameter)) {
-            declaratorListPar.identifier.codeFragment.print("error: identifier with the same name already exists!");
-            throw "Failure!";
-        };
+    if(functionDefinition.parameters.has_value()) {
+        const syntax_analysis::DeclaratorList& declaratorListPar = functionDefinition.parameters.value().declaratorList;
+        if(!addIdentifier(declaratorListPar.identifier, Identifier::Type::Parameter)) {
+            return nullptr;
+        }
         count_parameters++;
-        auto repeating = declaratorListPar.repeating.get();
+        auto repeating = declaratorListPar.repeating;
         while(repeating) {
-            if(!symbolTable.addIdentifier(repeating->identifier.codeFragment, Identifier::Type::Parameter)) {
-                repeating->identifier.codeFragment.print("error: identifier with the same name already exists!");
-                throw "Failure!";
-            };
+            if(!addIdentifier(repeating->identifier, Identifier::Type::Parameter)) {
+                return nullptr;
+            }
             count_parameters++;
-            repeating = repeating->next.get();
+            repeating = repeating->next;
         }
     }
 
-    if(syntaxTree.variables.has_value()) {
-        const syntax_analysis::DeclaratorList& declaratorListVar = syntaxTree.variables.value().declaratorList;
-        if(!symbolTable.addIdentifier(declaratorListVar.identifier.codeFragment, Identifier::Type::Variable)) {
-            declaratorListVar.identifier.codeFragment.print("error: identifier with the same name already exists!");
-            throw "Failure!";
-        };
-        auto repeating = declaratorListVar.repeating.get();
+    if(functionDefinition.variables.has_value()) {
+        const syntax_analysis::DeclaratorList& declaratorListVar = functionDefinition.variables.value().declaratorList;
+        if(!addIdentifier(declaratorListVar.identifier, Identifier::Type::Variable)) {
+            return nullptr;
+        }
+        auto repeating = declaratorListVar.repeating;
         while(repeating) {
-            if(!symbolTable.addIdentifier(repeating->identifier.codeFragment, Identifier::Type::Variable)) {
-                repeating->identifier.codeFragment.print("error: identifier with the same name already exists!");
-                throw "Failure!";
-            };
-            repeating = repeating->next.get();
+            if(!addIdentifier(repeating->identifier, Identifier::Type::Variable)) {
+                return nullptr;
+            }
+            repeating = repeating->next;
         }
     }
 
-    if(syntaxTree.constants.has_value()) {
-        const syntax_analysis::InitDeclaratorList& declaratorListConst = syntaxTree.constants.value().initDeclaratorList;
-        if(!symbolTable.addIdentifier(declaratorListConst.initDeclarator.identifier.codeFragment, Identifier::Type::Constant, stringToInt(declaratorListConst.initDeclarator.literal.codeFragment.getString()))) {
-            declaratorListConst.initDeclarator.identifier.codeFragment.print("error: identifier with the same name already exists!");
-            throw "Failure!";
-        };
-        auto repeating = declaratorListConst.repeating.get();
+    if(functionDefinition.constants.has_value()) {
+        const syntax_analysis::InitDeclaratorList& declaratorListConst = functionDefinition.constants.value().initDeclaratorList;
+        const syntax_analysis::InitDeclarator& initDeclarator = declaratorListConst.initDeclarator;
+        if(!addIdentifier(initDeclarator.identifier, Identifier::Type::Constant, stringToInt(codeManager.getString(initDeclarator.literal.codeFragment)))) {
+            return nullptr;
+        }
+        auto repeating = declaratorListConst.repeating;
         while(repeating) {
-            if(!symbolTable.addIdentifier(repeating->initDeclarator.identifier.codeFragment, Identifier::Type::Constant)) {
-                repeating->initDeclarator.identifier.codeFragment.print("error: identifier with the same name already exists!");
-                throw "Failure!";
-            };
-            repeating = repeating->next.get();
+            const syntax_analysis::InitDeclarator& repeatingInitDeclarator = repeating->initDeclarator;
+            if(!addIdentifier(repeatingInitDeclarator.identifier, Identifier::Type::Constant, stringToInt(codeManager.getString(repeatingInitDeclarator.literal.codeFragment)))) {
+                return nullptr;
+            }
+            repeating = repeating->next;
         }
     }
 
-    return std::make_unique<Function>(analyseStatement(syntaxTree.compoundStatement.statementList));
-}
-
-/// depending on if there is a next statement, it has to either be a ReturnStatement or a NormalStatement
-std::unique_ptr<Statement> SemanticAnalyser::analyseStatement(const syntax_analysis::StatementList& statementList) {
-    std::unique_ptr<Statement> next = analyseStatement(statementList.repeating.get());
-    if(next != nullptr) {
-        std::unique_ptr<AssignmentExpression> expression = analyseAssignmentExpression(statementList.statement.assignmentExpression.value());
-        return std::make_unique<NormalStatement>(std::move(expression), std::move(next));
-    } else {
-        std::unique_ptr<Arithmetic> arithmetic = analyseArithmeticExpression(statementList.statement.returnAdditive->additiveExpression);
-        return std::make_unique<ReturnStatement>(std::move(arithmetic));
+    auto function = std::make_unique<Function>();
+    if(!analyseStatement(functionDefinition.compoundStatement.statementList, *function)) {
+        return nullptr;
     }
+    return function;
 }
 
-/// parses repeating part of Statement
-std::unique_ptr<Statement> SemanticAnalyser::analyseStatement(const syntax_analysis::StatementList::Repeating* repeating) {
-    if(!repeating) {
-        return nullptr;
-    } else {
-        std::unique_ptr<Statement> next = analyseStatement(repeating->next.get());
-        if(next == nullptr) {
-            return std::make_unique<ReturnStatement>(analyseArithmeticExpression(repeating->statement.returnAdditive.value().additiveExpression));
-        } else {
-            std::unique_ptr<AssignmentExpression> expression = analyseAssignmentExpression(repeating->statement.assignmentExpression.value());
-            return std::make_unique<NormalStatement>(std::move(expression), std::move(next));
+/// all statements before the last one have to be NormalStatements, the last one has to be a ReturnStatement
+/// the statements get appended to the function in a loop, so long statement lists don't need one stack frame per statement
+bool SemanticAnalyser::analyseStatement(const syntax_analysis::StatementList& statementList, Function& function) {
+    const syntax_analysis::Statement* statement = &statementList.statement;
+    const syntax_analysis::StatementList::Repeating* repeating = statementList.repeating;
+    while(repeating) {
+        if(!statement->assignmentExpression.has_value()) {
+            diagnostics.report(statement->returnAdditive->RETURN.codeFragment, "error: RETURN has to be the last statement");
+            return false;
+        }
+        if(!analyseAssignmentExpression(statement->assignmentExpression.value(), function)) {
+            return false;
         }
+        statement = &repeating->statement;
+        repeating = repeating->next;
     }
+    if(!statement->returnAdditive.has_value()) {
+        diagnostics.report(statement->assignmentExpression->identifier.codeFragment, "error: RETURN statement missing");
+        return false;
+    }
+    uint32_t begin = function.nodes.size();
+    if(!analyseArithmeticExpression(statement->returnAdditive->additiveExpression, function)) {
+        return false;
+    }
+    function.addStatement(begin, Statement::returnTarget);
+    return true;
 }
 
-std::unique_ptr<AssignmentExpression> SemanticAnalyser::analyseAssignmentExpression(const syntax_analysis::AssignmentExpression& assignmentExpression) {
+bool SemanticAnalyser::analyseAssignmentExpression(const syntax_analysis::AssignmentExpression& assignmentExpression, Function& function) {
     /// check if identifier is in symbolTable + is not const
-    const Identifier* identifier = symbolTable.getIdentifier(assignmentExpression.identifier.codeFragment.getString());
+    const Identifier* identifier = symbolTable.getIdentifier(assignmentExpression.identifier.nameId);
     if(!identifier) {
-        assignmentExpression.identifier.codeFragment.print("error: identifier not defined!");
-        throw "Failure!";
-    } else {
-        if(identifier->type == Identifier::Type::Constant) {
-            assignmentExpression.identifier.codeFragment.print("error: identifier is constant!");
-            throw "Failure!";
-        } else {
-            return std::make_unique<AssignmentExpression>(identifier->id, assignmentExpression.identifier.codeFragment.getString(), analyseArithmeticExpression(assignmentExpression.additiveExpression));
-        }
+        diagnostics.report(assignmentExpression.identifier.codeFragment, "error: identifier not defined!");
+        return false;
+    } else if(identifier->type == Identifier::Type::Constant) {
+        diagnostics.report(assignmentExpression.identifier.codeFragment, "error: identifier is constant!");
+        return false;
+    }
+    uint32_t begin = function.nodes.size();
+    if(!analyseArithmeticExpression(assignmentExpression.additiveExpression, function)) {
+        return false;
     }
+    function.addStatement(begin, identifier->id);
+    return true;
 }
 
-std::unique_ptr<Arithmetic> SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::AdditiveExpression& additiveExpression) {
-   std::unique_ptr<Arithmetic> left = analyseArithmeticExpression(additiveExpression.multiplicativeExpression);
-   if(additiveExpression.additiveExpression == nullptr) {
-       /// no right branch
-       return left;
-   } else if(additiveExpression.whichOperator == syntax_analysis::AdditiveExpression::WhichOperator::Plus) {
-       /// right branch with Plus as BinaryOperator
-       return std::make_unique<BinaryOperator>(BinaryOperator::Type::Plus, std::move(left), analyseArithmeticExpression(*additiveExpression.additiveExpression));
-   } else {
-       /// right branch with Minus as BinaryOperator
-       return std::make_unique<BinaryOperator>(BinaryOperator::Type::Minus, std::move(left), analyseArithmeticExpression(*additiveExpression.additiveExpression));
-   }
+/// appends the right-leaning chain of binary operators over the roots of the operands and the operators between them
+/// the operands are already appended in order, so the result stays in post-order
+static void foldRight(Function& function, const std::vector<uint32_t>& operands, const std::vector<Node::Type>& operators) {
+    uint32_t result = operands.back();
+    for(size_t i = operators.size(); i > 0; i--) {
+        result = function.addNode(Node::binary(operators[i - 1], operands[i - 1], result));
+    }
 }
 
-std::unique_ptr<Arithmetic> SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::MultiplicativeExpression& multiplicativeExpression) {
-    std::unique_ptr<Arithmetic> left = analyseArithmeticExpression(multiplicativeExpression.unaryExpression);
-    if(multiplicativeExpression.multiplicativeExpression == nullptr) {
-        /// no right branch
-        return left;
-    } else if(multiplicativeExpression.whichOperator == syntax_analysis::MultiplicativeExpression::WhichOperator::Multiplication) {
-        /// right branch with Multiplication as BinaryOperator
-        return std::make_unique<BinaryOperator>(BinaryOperator::Type::Multiplication, std::move(left), analyseArithmeticExpression(*multiplicativeExpression.multiplicativeExpression));
-    } else {
-        /// right branch with Division as BinaryOperator
-        return std::make_unique<BinaryOperator>(BinaryOperator::Type::Division, std::move(left), analyseArithmeticExpression(*multiplicativeExpression.multiplicativeExpression));
+bool SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::AdditiveExpression& additiveExpression, Function& function) {
+    std::vector<uint32_t> operands;
+    std::vector<Node::Type> operators;
+    for(const syntax_analysis::AdditiveExpression* current = &additiveExpression; current != nullptr; current = current->additiveExpression) {
+        if(!analyseArithmeticExpression(current->multiplicativeExpression, function)) {
+            return false;
+        }
+        operands.push_back(function.nodes.size() - 1);
+        if(current->whichOperator == syntax_analysis::AdditiveExpression::WhichOperator::Plus) {
+            operators.push_back(Node::Type::Plus);
+        } else if(current->whichOperator == syntax_analysis::AdditiveExpression::WhichOperator::Minus) {
+            operators.push_back(Node::Type::Minus);
+        }
     }
+    foldRight(function, operands, operators);
+    return true;
 }
 
-std::unique_ptr<Arithmetic> SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::UnaryExpression& unaryExpression) {
-    std::unique_ptr<Arithmetic> next = analyseArithmeticExpression(unaryExpression.primaryExpression);
+bool SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::MultiplicativeExpression& multiplicativeExpression, Function& function) {
+    std::vector<uint32_t> operands;
+    std::vector<Node::Type> operators;
+    for(const syntax_analysis::MultiplicativeExpression* current = &multiplicativeExpression; current != nullptr; current = current->multiplicativeExpression) {
+        if(!analyseArithmeticExpression(current->unaryExpression, function)) {
+            return false;
+        }
+        operands.push_back(function.nodes.size() - 1);
+        if(current->whichOperator == syntax_analysis::MultiplicativeExpression::WhichOperator::Multiplication) {
+            operators.push_back(Node::Type::Multiplication);
+        } else if(current->whichOperator == syntax_analysis::MultiplicativeExpression::WhichOperator::Divide) {
+            operators.push_back(Node::Type::Division);
+        }
+    }
+    foldRight(function, operands, operators);
+    return true;
+}
+
+bool SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::UnaryExpression& unaryExpression, Function& function) {
+    if(!analyseArithmeticExpression(unaryExpression.primaryExpression, function)) {
+        return false;
+    }
+    uint32_t next = function.nodes.size() - 1;
     if(unaryExpression.whichOperator == syntax_analysis::UnaryExpression::WhichOperator::Plus) {
         /// UnaryNode with Plus
-        return std::make_unique<UnaryOperator>(UnaryOperator::Type::Plus, std::move(next));
+        function.addNode(Node::unary(Node::Type::UnaryPlus, next));
     } else if(unaryExpression.whichOperator == syntax_analysis::UnaryExpression::WhichOperator::Minus) {
         /// UnaryNode with Minus
-        return std::make_unique<UnaryOperator>(UnaryOperator::Type::Minus, std::move(next));
-    } else {
-        /// no extra unary operator
-        return next;
+        function.addNode(Node::unary(Node::Type::UnaryMinus, next));
     }
+    /// else no extra unary operator
+    return true;
 }
 
-std::unique_ptr<Arithmetic> SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::PrimaryExpression& primaryExpression) {
+bool SemanticAnalyser::analyseArithmeticExpression(const syntax_analysis::PrimaryExpression& primaryExpression, Function& function) {
     if(primaryExpression.whichAlternative == syntax_analysis::PrimaryExpression::WhichAlternative::Identifier) {
         /// its an identifier
         /// check if identifier is in symbolTable
-        const Identifier* identifier = symbolTable.getIdentifier(primaryExpression.terminalNode.value().codeFragment.getString());
+        const Identifier* identifier = symbolTable.getIdentifier(primaryExpression.terminalNode.value().nameId);
         if(!identifier) {
             /// identifier is not in symbolTable
-            primaryExpression.terminalNode.value().codeFragment.print("error: identifier is not defined!");
-            throw "Failure!";
+            diagnostics.report(primaryExpression.terminalNode.value().codeFragment, "error: identifier is not defined!");
+            return false;
         } else if(identifier->type == Identifier::Type::Constant) {
-            return std::make_unique<Literal>(identifier->value);
+            function.addNode(Node::literal(identifier->value));
         } else {
-            return std::make_unique<IdentifierNode>(identifier->id, identifier->name);
+            function.addNode(Node::identifier(identifier->id));
         }
+        return true;
     } else if(primaryExpression.whichAlternative == syntax_analysis::PrimaryExpression::WhichAlternative::Literal) {
         /// its a literal
-        return std::make_unique<Literal>(primaryExpression.terminalNode.value().codeFragment.getString());
+        function.addNode(Node::literal(stringToInt(codeManager.getString(primaryExpression.terminalNode.value().codeFragment))));
+        return true;
     } else {
         /// its an AdditiveExpression
-        return analyseArithmeticExpression(*primaryExpression.additiveExpressionBrackets.value().additiveExpression);
+        return analyseArithmeticExpression(*primaryExpression.additiveExpressionBrackets.value().additiveExpression, function);
     }
 }
 
-void Print::visit(const Function& node) {
-    std::cout << maxId++ << " [label = \"function\"]" << std::endl;
-    const NormalStatement* normalStatement = getNormalStatement(node.statement.get());
-    // its a normalStatement
-    if(normalStatement != nullptr) {
-        std::cout << maxId++ << " [label = \"normalStatement\"]" << std::endl;
-    // its a returnStatement
-    } else {
-        std::cout << maxId++ << " [label = \"returnStatement\"]" << std::endl;
-    }
-    std::cout << maxId - 2 << " -> " << maxId - 1 << std::endl;
-    visit(*node.statement, maxId - 1);
+//--------------------------------------------------------------------
+// Begin: single pass analysis
+
+/// checks if token is the given keyword
+static bool isKeyword(const Token* token, Keyword::Keywords keyword) {
+    return token && token->type == Token::Type::Keyword && static_cast<const Keyword*>(token)->keywords == keyword;
 }
 
-void Print::visit(const Arithmetic& node, unsigned thisId) {
-    const
+/// checks if token is the given separator
+static bool isSeparator(const Token* token, Separator::Separators separator) {
+    return token && token->type == Token::Type::Separator && static_cast<const Separator*>(token)->separators == separator;
 }
 
-void Print::visit(const BinaryOperator& node, unsigned thisId) {
+/// checks if token is the given operator
+static bool isOperator(const Token* token, Operator::Operators tokenOperator) {
+    return token && token->type == Token::Type::Operator && static_cast<const Operator*>(token)->operators == tokenOperator;
+}
 
+/// get new token if nullpointer
+void SinglePassAnalyser::getToken() {
+    if(!token) {
+        token_ptr = lexer.next();
+        token = token_ptr.get();
+    }
 }
 
-void Print::visit(const UnaryOperator& node, unsigned thisId) {
+/// delete token if used up
+void SinglePassAnalyser::deleteToken() {
+    token_ptr.reset();
+    token = nullptr;
+}
 
+/// reports error at current token, or at the end of the code if there is none left
+void SinglePassAnalyser::fail(std::string_view message) {
+    if(token) {
+        diagnostics.report(token->codeFragment, message);
+    } else if(!lexer.hasFailed()) {
+        // lexer already reported why there is no token
+        diagnostics.report(codeManager.endOfCode(), message);
+    }
 }
 
-void Print::visit(const Literal& node, unsigned thisId) {
+/// adds declared identifier to symbolTable, gives back false if the name already exists
+bool SinglePassAnalyser::addIdentifier(const lexical_analysis::Identifier& identifier, Identifier::Type type, int64_t value) {
+    if(!symbolTable.addIdentifier(identifier.nameId, codeManager.getString(identifier.codeFragment), type, value)) {
+        diagnostics.report(identifier.codeFragment, "error: identifier with the same name already exists!");
+        return false;
+    }
+    return true;
+}
 
+/// parses declarations + compound statement, returns root of AST or nullptr if the code is invalid
+std::unique_ptr<Function> SinglePassAnalyser::analyseFunction() {
+    getToken();
+    if(isKeyword(token, Keyword::Keywords::PARAM)) {
+        deleteToken();
+        if(!analyseDeclaratorList(Identifier::Type::Parameter)) {
+            return nullptr;
+        }
+    }
+    getToken();
+    if(isKeyword(token, Keyword::Keywords::VAR)) {
+        deleteToken();
+        if(!analyseDeclaratorList(Identifier::Type::Variable)) {
+            return nullptr;
+        }
+    }
+    getToken();
+    if(isKeyword(token, Keyword::Keywords::CONST)) {
+        deleteToken();
+        if(!analyseInitDeclaratorList()) {
+            return nullptr;
+        }
+    }
+    getToken();
+    if(!isKeyword(token, Keyword::Keywords::BEGIN)) {
+        fail("error: expected \"BEGIN\"");
+        return nullptr;
+    }
+    deleteToken();
+    auto function = std::make_unique<Function>();
+    if(!analyseStatementList(*function)) {
+        return nullptr;
+    }
+    getToken();
+    if(!isKeyword(token, Keyword::Keywords::END)) {
+        fail("error: expected \"END\"");
+        return nullptr;
+    }
+    deleteToken();
+    getToken();
+    if(!isSeparator(token, Separator::Separators::point)) {
+        fail("error: point missing");
+        return nullptr;
+    }
+    deleteToken();
+    return function;
 }
 
-void Print::visit(const IdentifierNode& node, unsigned thisId) {
+/// adds all identifiers of declarator-list to symbolTable, consumes closing semicolon
+bool SinglePassAnalyser::analyseDeclaratorList(Identifier::Type type) {
+    while(true) {
+        getToken();
+        if(!token || token->type != Token::Type::Identifier) {
+            fail("error: expected identifier");
+            return false;
+        }
+        if(!addIdentifier(*static_cast<const lexical_analysis::Identifier*>(token), type)) {
+            return false;
+        }
+        if(type == Identifier::Type::Parameter) {
+            count_parameters++;
+        }
+        deleteToken();
+        getToken();
+        if(!isSeparator(token, Separator::Separators::comma)) {
+            break;
+        }
+        deleteToken();
+    }
+    if(!isSeparator(token, Separator::Separators::semicolon)) {
+        fail("error: semicolon missing");
+        return false;
+    }
+    deleteToken();
+    return true;
+}
 
+/// adds all constants of init-declarator-list to symbolTable, consumes closing semicolon
+bool SinglePassAnalyser::analyseInitDeclaratorList() {
+    while(true) {
+        getToken();
+        if(!token || token->type != Token::Type::Identifier) {
+            fail("error: expected valid identifier");
+            return false;
+        }
+        lexical_analysis::Identifier identifier = *static_cast<const lexical_analysis::Identifier*>(token);
+        deleteToken();
+        getToken();
+        if(!isOperator(token, Operator::Operators::EqualsInit)) {
+            fail("error: expected \"=\"");
+            return false;
+        }
+        deleteToken();
+        getToken();
+        if(!token || token->type != Token::Type::Literal) {
+            fail("error: expected valid literal");
+            return false;
+        }
+        if(!addIdentifier(identifier, Identifier::Type::Constant, static_cast<const lexical_analysis::Literal*>(token)->number)) {
+            return false;
+        }
+        deleteToken();
+        getToken();
+        if(!isSeparator(token, Separator::Separators::comma)) {
+            break;
+        }
+        deleteToken();
+    }
+    if(!isSeparator(token, Separator::Separators::semicolon)) {
+        fail("error: semicolon missing");
+        return false;
+    }
+    deleteToken();
+    return true;
 }
 
-void Print::visit(const Statement& node, unsigned thisId) {
+/// all statements before the RETURN become NormalStatements, RETURN has to be the last statement
+bool SinglePassAnalyser::analyseStatementList(Function& function) {
+    while(true) {
+        getToken();
+        if(isKeyword(token, Keyword::Keywords::RETURN)) {
+            deleteToken();
+            uint32_t begin = function.nodes.size();
+            if(!analyseAdditiveExpression(function)) {
+                return false;
+            }
+            function.addStatement(begin, Statement::returnTarget);
+            getToken();
+            if(isSeparator(token, Separator::Separators::semicolon)) {
+                fail("error: RETURN has to be the last statement");
+                return false;
+            }
+            return true;
+        }
+        if(!analyseAssignmentExpression(function)) {
+            return false;
+        }
+        getToken();
+        if(!isSeparator(token, Separator::Separators::semicolon)) {
+            fail(isKeyword(token, Keyword::Keywords::END) ? "error: RETURN statement missing" : "error: semicolon missing");
+            return false;
+        }
+        deleteToken();
+    }
+}
 
+bool SinglePassAnalyser::analyseAssignmentExpression(Function& function) {
+    getToken();
+    if(!token || token->type != Token::Type::Identifier) {
+        fail("error: expected identifier");
+        return false;
+    }
+    /// check if identifier is in symbolTable + is not const
+    const Identifier* identifier = symbolTable.getIdentifier(static_cast<const lexical_analysis::Identifier*>(token)->nameId);
+    if(!identifier) {
+        fail("error: identifier not defined!");
+        return false;
+    } else if(identifier->type == Identifier::Type::Constant) {
+        fail("error: identifier is constant!");
+        return false;
+    }
+    deleteToken();
+    getToken();
+    if(!isOperator(token, Operator::Operators::EqualsAssignment)) {
+        fail("error: expected \":=\"");
+        return false;
+    }
+    deleteToken();
+    uint32_t begin = function.nodes.size();
+    if(!analyseAdditiveExpression(function)) {
+        return false;
+    }
+    function.addStatement(begin, identifier->id);
+    return true;
 }
 
-void Print::visit(const NormalStatement& node, unsigned thisId) {
+bool SinglePassAnalyser::analyseAdditiveExpression(Function& function) {
+    std::vector<uint32_t> operands;
+    std::vector<Node::Type> operators;
+    while(true) {
+        if(!analyseMultiplicativeExpression(function)) {
+            return false;
+        }
+        operands.push_back(function.nodes.size() - 1);
+        getToken();
+        if(isOperator(token, Operator::Operators::Plus)) {
+            operators.push_back(Node::Type::Plus);
+        } else if(isOperator(token, Operator::Operators::Minus)) {
+            operators.push_back(Node::Type::Minus);
+        } else {
+            break;
+        }
+        deleteToken();
+    }
+    foldRight(function, operands, operators);
+    return true;
+}
 
+bool SinglePassAnalyser::analyseMultiplicativeExpression(Function& function) {
+    std::vector<uint32_t> operands;
+    std::vector<Node::Type> operators;
+    while(true) {
+        if(!analyseUnaryExpression(function)) {
+            return false;
+        }
+        operands.push_back(function.nodes.size() - 1);
+        getToken();
+        if(isOperator(token, Operator::Operators::Multiplication)) {
+            operators.push_back(Node::Type::Multiplication);
+        } else if(isOperator(token, Operator::Operators::Division)) {
+            operators.push_back(Node::Type::Division);
+        } else {
+            break;
+        }
+        deleteToken();
+    }
+    foldRight(function, operands, operators);
+    return true;
 }
 
-void Print::visit(const ReturnStatement& node, unsigned thisId) {
+bool SinglePassAnalyser::analyseUnaryExpression(Function& function) {
+    getToken();
+    Node::Type type;
+    if(isOperator(token, Operator::Operators::Plus)) {
+        type = Node::Type::UnaryPlus;
+    } else if(isOperator(token, Operator::Operators::Minus)) {
+        type = Node::Type::UnaryMinus;
+    } else {
+        /// no extra unary operator
+        return analysePrimaryExpression(function);
+    }
+    deleteToken();
+    if(!analysePrimaryExpression(function)) {
+        return false;
+    }
+    function.addNode(Node::unary(type, function.nodes.size() - 1));
+    return true;
+}
 
+bool SinglePassAnalyser::analysePrimaryExpression(Function& function) {
+    getToken();
+    if(token && token->type == Token::Type::Identifier) {
+        /// check if identifier is in symbolTable
+        const Identifier* identifier = symbolTable.getIdentifier(static_cast<const lexical_analysis::Identifier*>(token)->nameId);
+        if(!identifier) {
+            fail("error: identifier is not defined!");
+            return false;
+        }
+        deleteToken();
+        if(identifier->type == Identifier::Type::Constant) {
+            function.addNode(Node::literal(identifier->value));
+        } else {
+            function.addNode(Node::identifier(identifier->id));
+        }
+        return true;
+    } else if(token && token->type == Token::Type::Literal) {
+        int64_t number = static_cast<const lexical_analysis::Literal*>(token)->number;
+        deleteToken();
+        function.addNode(Node::literal(number));
+        return true;
+    } else if(isOperator(token, Operator::Operators::BracketsOpen)) {
+        deleteToken();
+        if(!analyseAdditiveExpression(function)) {
+            return false;
+        }
+        getToken();
+        if(!isOperator(token, Operator::Operators::BracketsClosed)) {
+            fail("error: missing \")\"");
+            return false;
+        }
+        deleteToken();
+        return true;
+    }
+    fail("error: expected identifier, literal or \"(\"");
+    return false;
 }
 
-void Print::visit(const MultiplicativeExpression& node, unsigned thisId) {
-    std::cout << maxId++ << " [label = \"unaryExpression\"]" << std::endl;
-    std::cout << thisId << " -> " << maxId - 1 << std::endl;
-    visit(node.unaryExpression, maxId - 1);
-    if(node.whichOperator == MultiplicativeExpression::WhichOperator::Multiplication) {
-        std::cout << maxId++ << " [label = \"*\"]" << std::endl;
-        std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        std::cout << maxId++ << " [label = \"multiplicativeExpression\"]" << std::endl;
-        std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(*node.multiplicativeExpression, maxId - 1);
-    } else if(node.whichOperator == MultiplicativeExpression::WhichOperator::Divide) {
-        std::cout << maxId++ << " [label = \"/\"]" << std::endl;
-        std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        std::cout << maxId++ << " [label = \"multiplicativeExpression\"]" << std::endl;
-        std::cout << thisId << " -> " << maxId - 1 << std::endl;
-        visit(*node.multiplicativeExpression, maxId - 1);
+// End: single pass analysis
+//--------------------------------------------------------------------
+
+//--------------------------------------------------------------------
+// Begin: visit Methods for printing AST
+
+/// the nodes get the ids 1 to nodes.size(), statements and assignments the following ones
+void Print::visit(const Function& node) {
+    maxId = node.nodes.size() + 1;
+    std::cout << "digraph {" << std::endl;
+    std::cout << 0 << " [label = \"function\"]" << std::endl;
+    for(size_t i = 0; i < node.nodes.size(); i++) {
+        const Node& current = node.nodes[i];
+        std::cout << i + 1 << " [label = \"";
+        switch(current.type) {
+            case Node::Type::Literal: std::cout << current.number; break;
+            case Node::Type::Identifier: std::cout << identifiers[current.left].name; break;
+            case Node::Type::UnaryPlus:
+            case Node::Type::Plus: std::cout << "+"; break;
+            case Node::Type::UnaryMinus:
+            case Node::Type::Minus: std::cout << "-"; break;
+            case Node::Type::Multiplication: std::cout << "*"; break;
+            case Node::Type::Division: std::cout << "/"; break;
+        }
+        std::cout << "\"]" << std::endl;
+        if(current.isUnary() || current.isBinary()) {
+            std::cout << i + 1 << " -> " << current.left + 1 << std::endl;
+        }
+        if(current.isBinary()) {
+            std::cout << i + 1 << " -> " << current.right + 1 << std::endl;
+        }
     }
+    // each statement links to the next one
+    unsigned parentId = 0;
+    for(const Statement& statement : node.statements) {
+        unsigned statementId = maxId++;
+        std::cout << statementId << " [label = \"" << (statement.isReturn() ? "returnStatement" : "normalStatement") << "\"]" << std::endl;
+        std::cout << parentId << " -> " << statementId << std::endl;
+        unsigned rootParentId = statementId;
+        if(!statement.isReturn()) {
+            rootParentId = maxId++;
+            std::cout << rootParentId << " [label = \":=\"]" << std::endl;
+            std::cout << statementId << " -> " << rootParentId << std::endl;
+            std::cout << maxId++ << " [label = \"" << identifiers[statement.target].name << "\"]" << std::endl;
+            std::cout << rootParentId << " -> " << maxId - 1 << std::endl;
+        }
+        std::cout << rootParentId << " -> " << statement.root() + 1 << std::endl;
+        parentId = statementId;
+    }
+    std::cout << "}" << std::endl;
 }
 
+// End: visit Methods for printing AST
+//--------------------------------------------------------------------
+
 
 } // namespace semantic_analysis
 //--------------------------------------------------------------
\ No newline at end of file
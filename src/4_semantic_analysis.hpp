@@ -3,12 +3,14 @@
 #include "1_code_management.hpp"
 #include "2_lexer.hpp"
 #include "3_syntax_analysis.hpp"
-#include <unordered_map>
+#include <span>
+#include <vector>
 //--------------------------------------------------------------
 namespace semantic_analysis {
 
 /*
  * most important class is SemanticAnalyser, which provides methods to create ASTNodes
+ * SinglePassAnalyser creates the same ASTNodes directly from the tokens, without the parse tree
  */
 
 /// saves information about Identifier
@@ -19,246 +21,199 @@ class Identifier {
         Variable,
         Constant
     };
+    /// points into the NamePool if there is one, else into the source code
     std::string_view name;
-    code_management::CodeFragment codeFragment;
-    Type type;
     int64_t value = 0;
+    Type type;
+    /// index in the SymbolTable, parameters come first
     unsigned id;
+    /// id of the name in the NamePool (same in all functions), or in the lexer if there is no NamePool
+    unsigned nameId;
     /// default constructor
     Identifier() = default;
     /// constructor
-    Identifier(code_management::CodeFragment codeFragment, Type type, unsigned id)
-        : name(codeFragment.getString()), codeFragment(codeFragment), type(type), id(id) {}
-    Identifier(code_management::CodeFragment codeFragment, Type type, int64_t value, unsigned id)
-        : name(codeFragment.getString()), codeFragment(codeFragment), type(type), value(value), id(id) {}
+    Identifier(std::string_view name, Type type, unsigned id, unsigned nameId)
+        : name(name), type(type), id(id), nameId(nameId) {}
+    Identifier(std::string_view name, Type type, int64_t value, unsigned id, unsigned nameId)
+        : name(name), value(value), type(type), id(id), nameId(nameId) {}
 };
 
 /// SymbolTable which saves all identifiers + information
+/// names are interned by the lexer, so lookups are array accesses instead of hashing
 class SymbolTable {
+    private:
+    /// marks names which are not declared
+    static constexpr unsigned undeclared = ~0u;
+    /// id of the declared identifier for each name id
+    std::vector<unsigned> idOfName;
+    /// shared names of all functions, can be nullptr
+    code_management::NamePool* namePool;
     public:
-    std::unordered_map<std::string_view, Identifier> hashTable;
-    /// constructor
-    SymbolTable() = default;
+    /// all declared identifiers, index is the id
+    std::vector<Identifier> identifiers;
+    /// constructor, declared names get interned into the NamePool
+    explicit SymbolTable(code_management::NamePool* namePool = nullptr) : namePool(namePool) {}
     /// methods
     /// returns false, if identifier with same name already exists
-    bool addIdentifier(code_management::CodeFragment codeFragment, Identifier::Type type);
-    bool addIdentifier(code_management::CodeFragment codeFragment, Identifier::Type type, int64_t value);
+    bool addIdentifier(unsigned nameId, std::string_view name, Identifier::Type type, int64_t value = 0);
     /// returns nullptr if identifier doesnt exist
-    const Identifier* getIdentifier(std::string_view name);
-};
-
-/// virtual class of ASTNode
-class ASTNode {
-    public:
-    /// possible derived classes
-    enum class Type {
-        Function, // function has one statement
-        Statement, // statement can either have expression + next statement or return + expression
-        AssignmentExpression, // identifier + arithmetic
-        Arithmetic // leftArithmetic + Operator + rightArithmetic or plus/minus + Arithmetic or literal or identifier
-    };
-    Type type;
-    /// constructor
-    explicit ASTNode(Type type) : type(type) {}
-    /// to make class virtual
-    virtual ~ASTNode() = default;
+    const Identifier* getIdentifier(unsigned nameId) const;
+    /// number of declared identifiers
+    size_t size() const { return identifiers.size(); }
 };
 
-/// virtual arithmetic node
-class Arithmetic : public ASTNode {
+/// node of the AST, all nodes of a function are stored in post-order (children before parents) in one array
+/// children are referred to by their index in that array
+class Node {
     public:
-    /// possible derived classes
-    enum class Type {
-        BinaryOperator,
-        UnaryOperator,
+    /// possible types, binary operators come last
+    enum class Type : uint8_t {
         Literal,
-        Identifier
-    };
-    Type type;
-    /// constructor
-    explicit Arithmetic(Type type) : ASTNode(ASTNode::Type::Arithmetic), type(type) {}
-    /// destructor
-    virtual ~Arithmetic() = default;
-};
-
-/// BinaryOperator
-class BinaryOperator : public Arithmetic {
-    public:
-    /// which operators
-    enum class Type {
+        Identifier,
+        UnaryPlus,
+        UnaryMinus,
         Plus,
         Minus,
         Multiplication,
         Division
     };
     Type type;
-    /// left node
-    std::unique_ptr<Arithmetic> left;
-    /// right node
-    std::unique_ptr<Arithmetic> right;
-    /// constructor
-    BinaryOperator(Type type, std::unique_ptr<Arithmetic> left, std::unique_ptr<Arithmetic> right)
-        : Arithmetic(Arithmetic::Type::BinaryOperator), type(type), left(std::move(left)), right(std::move(right)) {}
-    /// destructor
-    ~BinaryOperator() override = default;
-};
-
-/// UnaryOperator
-class UnaryOperator : public Arithmetic {
-    public:
-    /// which operators
-    enum class Type {
-        Plus,
-        Minus
+    /// left child, child of unary operators, or id of the identifier
+    uint32_t left;
+    union {
+        /// right child of binary operators
+        uint32_t right;
+        /// value of literals
+        int64_t number;
     };
-    Type type;
-    /// next arithmetic
-    std::unique_ptr<Arithmetic> next;
-    /// constructor
-    UnaryOperator(Type type, std::unique_ptr<Arithmetic> next)
-        : Arithmetic(Arithmetic::Type::UnaryOperator), type(type), next(std::move(next)) {}
-    /// destructor
-    ~UnaryOperator() override = default;
+    /// create nodes
+    static Node literal(int64_t number) { Node node; node.type = Type::Literal; node.left = 0; node.number = number; return node; }
+    static Node identifier(unsigned id) { Node node; node.type = Type::Identifier; node.left = id; node.number = 0; return node; }
+    static Node unary(Type type, uint32_t child) { Node node; node.type = type; node.left = child; node.number = 0; return node; }
+    static Node binary(Type type, uint32_t left, uint32_t right) { Node node; node.type = type; node.left = left; node.number = 0; node.right = right; return node; }
+    /// kind of node
+    bool isUnary() const { return type == Type::UnaryPlus || type == Type::UnaryMinus; }
+    bool isBinary() const { return type >= Type::Plus; }
 };
+static_assert(sizeof(Node) == 16, "Node should stay 16 bytes");
 
-/// Literal
-class Literal : public Arithmetic {
+/// statement, its nodes are nodes[begin, end) of the function, the last one is the root
+class Statement {
     public:
-    int64_t number;
-    /// constructor
-    explicit Literal(std::string_view numString);
-    explicit Literal(int64_t number) : Arithmetic(Arithmetic::Type::Literal), number(number) {}
-    /// destructor
-    ~Literal() override = default;
+    /// target of the ReturnStatement
+    static constexpr uint32_t returnTarget = ~0u;
+    uint32_t begin;
+    uint32_t end;
+    /// id of the assigned identifier, returnTarget for the ReturnStatement
+    uint32_t target;
+    /// index of the root node
+    uint32_t root() const { return end - 1; }
+    /// true for the ReturnStatement
+    bool isReturn() const { return target == returnTarget; }
 };
 
-/// Identifier
-class IdentifierNode : public Arithmetic {
+/// function, the statements get executed in order, the last one is the ReturnStatement
+class Function {
     public:
-    unsigned id;
-    std::string_view name;
-    /// constructor
-    explicit IdentifierNode(unsigned id, std::string_view name)
-        : Arithmetic(Arithmetic::Type::Identifier), id(id), name(name) {}
-    /// destructor
-    ~IdentifierNode() override = default;
-};
-
-/// assignmentExpression node
-class AssignmentExpression : public ASTNode {
-    public:
-    unsigned id;
-    std::string_view identifier;
-    std::unique_ptr<Arithmetic> arithmetic;
-    /// constructor
-    AssignmentExpression(unsigned id, std::string_view identifier, std::unique_ptr<Arithmetic> arithmetic)
-        : ASTNode(ASTNode::Type::AssignmentExpression), id(id), identifier(identifier), arithmetic(std::move(arithmetic)) {}
-    /// destructor
-    ~AssignmentExpression() override = default;
-};
-
-/// statement node
-class Statement : public ASTNode {
-    public:
-    enum class Type {
-        NormalStatement, // contains statement + next statement
-        ReturnStatement // only contains arithmetic
-    };
-    Type type;
-    /// constructor
-    explicit Statement(Type type) : ASTNode(ASTNode::Type::Statement), type(type) {}
-    /// destructor
-    virtual ~Statement() = default;
-};
-
-/// NormalStatement node
-class NormalStatement : public Statement {
-    public:
-    std::unique_ptr<AssignmentExpression> expression;
-    std::unique_ptr<Statement> nextStatement;
-    /// constructor
-    NormalStatement(std::unique_ptr<AssignmentExpression> expression, std::unique_ptr<Statement> nextStatement)
-        : Statement(Statement::Type::NormalStatement), expression(std::move(expression)), nextStatement(std::move(nextStatement)) {}
-    /// destructor
-    ~NormalStatement() override = default;
-};
-
-/// ReturnStatement node
-class ReturnStatement : public Statement {
-    public:
-    std::unique_ptr<Arithmetic> arithmetic;
-    /// constructor
-    explicit ReturnStatement(std::unique_ptr<Arithmetic> arithmetic)
-        : Statement(Statement::Type::ReturnStatement), arithmetic(std::move(arithmetic)) {}
-    /// destructor
-    ~ReturnStatement() override = default;
-};
-
-/// function node
-class Function : public ASTNode {
-    public:
-    std::unique_ptr<Statement> statement;
-    /// constructor
-    explicit Function(std::unique_ptr<Statement> statement) : ASTNode(ASTNode::Type::Function), statement(std::move(statement)) {}
-    /// destructor
-    ~Function() override = default;
+    /// nodes of all statements in post-order
+    std::vector<Node> nodes;
+    std::vector<Statement> statements;
+    /// appends node, gives back its index
+    uint32_t addNode(Node node) { nodes.push_back(node); return static_cast<uint32_t>(nodes.size() - 1); }
+    /// appends statement over all nodes added since begin
+    void addStatement(uint32_t begin, uint32_t target) { statements.push_back({begin, static_cast<uint32_t>(nodes.size()), target}); }
 };
 
 /// analyses semantics of program
 class SemanticAnalyser {
     private:
+    /// resolves CodeFragments of the parse tree
+    const CodeManager& codeManager;
+    /// collects errors
+    Diagnostics& diagnostics;
     syntax_analysis::SyntaxAnalyser syntaxAnalyser;
-    const syntax_analysis::FunctionDefinition syntaxTree;
+    /// nullopt if there were syntax errors
+    const std::optional<syntax_analysis::FunctionDefinition> syntaxTree;
     public:
     /// how many parameters
     unsigned count_parameters = 0;
     /// saves all symbols
     SymbolTable symbolTable;
-    explicit SemanticAnalyser(CodeManager& codeManager) : syntaxAnalyser(codeManager), syntaxTree(syntaxAnalyser.parseFunctionDefinition()) {}
+    /// names get interned into the NamePool if there is one
+    SemanticAnalyser(const CodeManager& codeManager, Diagnostics& diagnostics, code_management::NamePool* namePool = nullptr)
+        : codeManager(codeManager), diagnostics(diagnostics), syntaxAnalyser(codeManager, diagnostics), syntaxTree(syntaxAnalyser.parseFunctionDefinition()), symbolTable(namePool) {}
     /// analyse methods: for each ASTNode type, there is an analyse-method which takes a reference
-    /// for the corresponding parse node and returns an ASTNode
+    /// for the corresponding parse node and returns an ASTNode, or nullptr if there was an error
     std::unique_ptr<Function> analyseFunction();
     private:
-    std::unique_ptr<Statement> analyseStatement(const syntax_analysis::StatementList& statementList);
-    std::unique_ptr<Statement> analyseStatement(const syntax_analysis::StatementList::Repeating* repeating);
-    std::unique_ptr<AssignmentExpression> analyseAssignmentExpression(const syntax_analysis::AssignmentExpression& assignmentExpression);
-    std::unique_ptr<Arithmetic> analyseArithmeticExpression(const syntax_analysis::AdditiveExpression& additiveExpression);
-    std::unique_ptr<Arithmetic> analyseArithmeticExpression(const syntax_analysis::MultiplicativeExpression& multiplicativeExpression);
-    std::unique_ptr<Arithmetic> analyseArithmeticExpression(const syntax_analysis::UnaryExpression& unaryExpression);
-    std::unique_ptr<Arithmetic> analyseArithmeticExpression(const syntax_analysis::PrimaryExpression& primaryExpression);
+    /// adds declared identifier to symbolTable
+    bool addIdentifier(const syntax_analysis::TerminalNode& identifier, Identifier::Type type, int64_t value = 0);
+    /// the analyse methods append the nodes to the function, the root is the last node
+    bool analyseStatement(const syntax_analysis::StatementList& statementList, Function& function);
+    bool analyseAssignmentExpression(const syntax_analysis::AssignmentExpression& assignmentExpression, Function& function);
+    bool analyseArithmeticExpression(const syntax_analysis::AdditiveExpression& additiveExpression, Function& function);
+    bool analyseArithmeticExpression(const syntax_analysis::MultiplicativeExpression& multiplicativeExpression, Function& function);
+    bool analyseArithmeticExpression(const syntax_analysis::UnaryExpression& unaryExpression, Function& function);
+    bool analyseArithmeticExpression(const syntax_analysis::PrimaryExpression& primaryExpression, Function& function);
+};
+
+/// analyses semantics while parsing, without building the parse tree
+/// used for compilation, the SemanticAnalyser is kept for tooling on the parse tree
+class SinglePassAnalyser {
+    private:
+    /// resolves CodeFragments of tokens
+    const CodeManager& codeManager;
+    /// collects errors
+    Diagnostics& diagnostics;
+    Lexer lexer;
+    std::unique_ptr<Token> token_ptr;
+    Token* token;
+    public:
+    /// how many parameters
+    unsigned count_parameters = 0;
+    /// saves all symbols
+    SymbolTable symbolTable;
+    /// names get interned into the NamePool if there is one
+    SinglePassAnalyser(const CodeManager& codeManager, Diagnostics& diagnostics, code_management::NamePool* namePool = nullptr)
+        : codeManager(codeManager), diagnostics(diagnostics), lexer(codeManager, diagnostics), token_ptr(nullptr), token(nullptr), symbolTable(namePool) {}
+    /// parses the whole function and returns root of AST, or nullptr if there was an error
+    std::unique_ptr<Function> analyseFunction();
+    private:
+    /// get new token if nullpointer
+    void getToken();
+    /// delete token if used up
+    void deleteToken();
+    /// reports error at current token
+    void fail(std::string_view message);
+    /// adds declared identifier to symbolTable
+    bool addIdentifier(const lexical_analysis::Identifier& identifier, Identifier::Type type, int64_t value = 0);
+    /// analyse methods: for each grammar component which is still needed, there is an analyse-method which consumes its tokens
+    /// they append the nodes to the function, and give back false after reporting an error
+    bool analyseDeclaratorList(Identifier::Type type);
+    bool analyseInitDeclaratorList();
+    bool analyseStatementList(Function& function);
+    bool analyseAssignmentExpression(Function& function);
+    bool analyseAdditiveExpression(Function& function);
+    bool analyseMultiplicativeExpression(Function& function);
+    bool analyseUnaryExpression(Function& function);
+    bool analysePrimaryExpression(Function& function);
 };
 
-/// downcasts Arithmetic to UnaryOperator
-const UnaryOperator* getUnaryOperator(const Arithmetic* node);
-/// downcasts Arithmetic to BinaryOperator
-const BinaryOperator* getBinaryOperator(const Arithmetic* node);
-/// downcasts Arithmetic to Literal
-const Literal* getLiteral(const Arithmetic* node);
-/// downcasts Arithmetic to IdentifierNode
-const IdentifierNode* getIdentifier(const Arithmetic* node);
-/// downcasts Statement to NormalStatement
-const NormalStatement* getNormalStatement(const Statement* node);
-/// downcasts Statement to ReturnStatement
-const ReturnStatement* getReturnStatement(const Statement* node);
 /// converts string to int64_t
 int64_t stringToInt(std::string_view numString);
 
-/// implements printing of ASTNode
+/// implements printing of the AST
 class Print {
     private:
     /// unique id for nodes
     unsigned maxId = 0;
+    /// names of the identifiers, index is the id
+    std::span<const Identifier> identifiers;
     public:
-    /// visit methods for all node types
+    /// constructor
+    explicit Print(std::span<const Identifier> identifiers) : identifiers(identifiers) {}
+    /// prints all statements and nodes of the function
     void visit(const Function& node);
-    void visit(const Arithmetic& node, unsigned thisId);
-    void visit(const BinaryOperator& node, unsigned thisId);
-    void visit(const UnaryOperator& node, unsigned thisId);
-    void visit(const Literal& node, unsigned thisId);
-    void visit(const IdentifierNode& node, unsigned thisId);
-    void visit(const Statement& node, unsigned thisId);
-    void visit(const NormalStatement& node, unsigned thisId);
-    void visit(const ReturnStatement& node, unsigned thisId);
 };
 
 } // namespace semantic_analysis
@@ -1,180 +1,590 @@
 #include "1_code_management.hpp"
 #include "4_semantic_analysis.hpp"
+#include "5_optimization.hpp"
 #include "5_execution.hpp"
+#include <algorithm>
+#include <cassert>
+#include <functional>
 //--------------------------------------------------------------
 namespace execution {
 
 /// saves all variables in an array with id as index
-void Evaluation::evaluateSymbols(std::initializer_list<int64_t> list) {
-    auto& hashtable = semanticAnalyser.symbolTable.hashTable;
-    identifiers.reserve(hashtable.size());
-    for(auto pair : hashtable) {
-        auto& identifier = pair.second;
-        identifiers[identifier.id] = identifier;
+void Evaluation::evaluateSymbols(std::span<const int64_t> arguments) {
+    values.resize(identifiers.size());
+    for(size_t i = 0; i < identifiers.size(); i++) {
+        values[i] = identifiers[i].value;
     }
-    unsigned index = 0;
-    for(int64_t element : list) {
-        identifiers[index++].value = element;
+    // the frame only holds the parameters and the written slots, so more arguments would write past it
+    assert(arguments.size() <= parameterCount && "more arguments than parameters");
+    size_t count = std::min(arguments.size(), parameterCount);
+    for(size_t i = 0; i < count; i++) {
+        values[i] = arguments[i];
     }
 }
 
+/// parameters stay, because the arguments get passed by position, the slots which are still written come after them
+/// constants are already replaced by literals and reads of variables refer to their SSA values
+void Evaluation::compactFrame() {
+    std::vector<bool> written(identifiers.size(), false);
+    for(const optimization::Definition& definition : program->definitions) {
+        written[definition.slot] = true;
+    }
+    // outputs which are never assigned give back their initial value
+    for(uint32_t slot : outputSlots) {
+        written[slot] = true;
+    }
+    std::vector<uint32_t> newSlot(identifiers.size());
+    std::vector<semantic_analysis::Identifier> frame;
+    auto keep = [&](size_t i) {
+        newSlot[i] = frame.size();
+        frame.push_back(identifiers[i]);
+        frame.back().id = newSlot[i];
+    };
+    for(size_t i = 0; i < identifiers.size(); i++) {
+        if(identifiers[i].type == semantic_analysis::Identifier::Type::Parameter) {
+            keep(i);
+        }
+    }
+    parameterCount = frame.size();
+    for(size_t i = 0; i < identifiers.size(); i++) {
+        if(identifiers[i].type != semantic_analysis::Identifier::Type::Parameter && written[i]) {
+            keep(i);
+        }
+    }
+    program->renumberSlots(newSlot);
+    for(uint32_t& slot : outputSlots) {
+        slot = newSlot[slot];
+    }
+    identifiers = std::move(frame);
+}
+
+/// runs the pipeline, keeping the final values of the output slots
+void Evaluation::optimize(optimization::CompileReport* report) {
+    optimization::PassManager::createDefault(outputSlots).run(*program, report, identifiers);
+    compactFrame();
+    // a division which traps is never folded, so it would still be an instruction
+    // the outputs are read from the frame, which only gets filled by running the program
+    constant = outputSlots.empty() && program->definitions.empty() && program->instructions.size() == 1 && program->instructions[program->result].isConstant();
+    identifiers.shrink_to_fit();
+    program->instructions.shrink_to_fit();
+    program->definitions.shrink_to_fit();
+}
+
+/// resolves the names to the slots of the parameters
+Evaluation Evaluation::specialize(std::span<const std::pair<std::string_view, int64_t>> bindings, Diagnostics& diagnostics) const {
+    if(!program) {
+        diagnostics.report("error: function with compile errors can't be specialized!");
+        return Evaluation();
+    }
+    std::vector<std::pair<uint32_t, int64_t>> slots;
+    for(const auto& [name, value] : bindings) {
+        auto it = std::find_if(identifiers.begin(), identifiers.end(), [&](const semantic_analysis::Identifier& identifier) {
+            return identifier.type == semantic_analysis::Identifier::Type::Parameter && identifier.name == name;
+        });
+        if(it == identifiers.end()) {
+            diagnostics.report("error: unknown parameter in specialization!");
+            return Evaluation();
+        }
+        slots.emplace_back(it->id, value);
+    }
+    return specializeSlots(slots, false);
+}
+
+/// bound parameters become constants, so compactFrame drops them and the remaining parameters move up
+Evaluation Evaluation::specializeSlots(std::span<const std::pair<uint32_t, int64_t>> bindings, bool keepParameters) const {
+    assert(program && "function has compile errors");
+    Evaluation evaluation;
+    evaluation.identifiers = identifiers;
+    evaluation.outputSlots = outputSlots;
+    optimization::Program specialized = *program;
+    for(const auto& [slot, value] : bindings) {
+        if(!keepParameters) {
+            evaluation.identifiers[slot].type = semantic_analysis::Identifier::Type::Constant;
+            evaluation.identifiers[slot].value = value;
+        }
+        specialized.bindParameter(slot, value);
+    }
+    evaluation.program.emplace(std::move(specialized));
+    evaluation.optimize(nullptr);
+    return evaluation;
+}
+
+/// bytes on the heap owned by the evaluation
+size_t Evaluation::getMemoryUsage() const {
+    size_t bytes = identifiers.capacity() * sizeof(semantic_analysis::Identifier)
+        + values.capacity() * sizeof(int64_t)
+        + results.capacity() * sizeof(int64_t);
+    if(!program) {
+        return bytes;
+    }
+    return bytes + program->instructions.capacity() * sizeof(optimization::Instruction)
+        + program->definitions.capacity() * sizeof(optimization::Definition);
+}
+
 //--------------------------------------------------------------
 // Begin: evaluation functions
 
-int64_t Evaluation::evaluateFunction(std::initializer_list<int64_t> list) {
-    evaluateSymbols(list);
-    return evaluateStatement(function->statement.get());
+int64_t Evaluation::evaluateFunction(std::span<const int64_t> arguments) {
+    assert(program && "function has compile errors");
+    if(constant) {
+        return getConstant();
+    }
+    evaluateSymbols(arguments);
+    return evaluateProgram();
+}
+
+/// the final values of the selected variables are in the frame after the evaluation
+void Evaluation::evaluateFunction(std::span<const int64_t> arguments, std::span<int64_t> outputs) {
+    assert(outputs.size() == getOutputCount() && "one output per selected variable and one for the result");
+    outputs.back() = evaluateFunction(arguments);
+    for(size_t i = 0; i < outputSlots.size(); i++) {
+        outputs[i] = values[outputSlots[i]];
+    }
 }
 
-int64_t Evaluation::evaluateStatement(const semantic_analysis::Statement* statement) {
-    // normal statement
-    if(statement->type == semantic_analysis::Statement::Type::NormalStatement) {
-        return evaluateNormalStatement(semantic_analysis::getNormalStatement(statement));
-    // return statement
-    } else {
-        return evaluateReturnStatement(semantic_analysis::getReturnStatement(statement));
+/// executes the instructions in order, operands are always computed before their users
+/// the final versions of the slots get written back into the frame afterwards
+int64_t Evaluation::evaluateProgram() {
+    const std::vector<optimization::Instruction>& instructions = program->instructions;
+    results.resize(instructions.size());
+    for(size_t i = 0; i < instructions.size(); i++) {
+        const optimization::Instruction& instruction = instructions[i];
+        switch(instruction.opcode) {
+            case optimization::Instruction::Opcode::Constant:
+                results[i] = instruction.value;
+                break;
+            case optimization::Instruction::Opcode::Parameter:
+                results[i] = values[instruction.left];
+                break;
+            case optimization::Instruction::Opcode::Negate:
+            case optimization::Instruction::Opcode::ShiftLeft:
+            case optimization::Instruction::Opcode::DivideByPowerOfTwo:
+            case optimization::Instruction::Opcode::DivideByConstant:
+                results[i] = instruction.apply(results[instruction.left], 0);
+                break;
+            default:
+                results[i] = instruction.apply(results[instruction.left], results[instruction.right]);
+                break;
+        }
+    }
+    for(const optimization::Definition& definition : program->definitions) {
+        values[definition.slot] = results[definition.value];
     }
+    return results[program->result];
 }
 
-int64_t Evaluation::evaluateReturnStatement(const semantic_analysis::ReturnStatement* returnStatement) {
-    return evaluateArithmetic(returnStatement->arithmetic.get());
+// End: evaluation functions
+//--------------------------------------------------------------
+
+/// constructor lowers the AST to SSA form and runs the optimization passes over it
+/// if the code is invalid, program stays nullopt and the errors are in the diagnostics
+/// the analyser (lexer, names of the source, symbol lookup) and the AST only live during construction
+Evaluation::Evaluation(const CodeManager& codeManager, Diagnostics& diagnostics, code_management::NamePool* namePool, optimization::CompileReport* report, std::span<const std::string_view> outputs) {
+    semantic_analysis::SinglePassAnalyser semanticAnalyser(codeManager, diagnostics, namePool);
+    std::unique_ptr<semantic_analysis::Function> function = semanticAnalyser.analyseFunction();
+    if(!function) {
+        return;
+    }
+    identifiers = std::move(semanticAnalyser.symbolTable.identifiers);
+    for(std::string_view output : outputs) {
+        auto it = std::find_if(identifiers.begin(), identifiers.end(), [&](const semantic_analysis::Identifier& identifier) {
+            return identifier.type == semantic_analysis::Identifier::Type::Variable && identifier.name == output;
+        });
+        if(it == identifiers.end()) {
+            // the name comes from the caller, there is no place in the code to point to
+            diagnostics.report("error: output is not a variable!");
+            return;
+        }
+        outputSlots.push_back(it->id);
+    }
+    program.emplace(*function, identifiers);
+    optimize(report);
 }
 
-int64_t Evaluation::evaluateNormalStatement(const semantic_analysis::NormalStatement* normalStatement) {
-    evaluateAssignmentExpression(normalStatement->expression.get());
-    return evaluateStatement(normalStatement->nextStatement.get());
+//--------------------------------------------------------------
+// Begin: speculation
 
+/// missing arguments are 0, like the initial value of parameters
+static int64_t getArgument(std::span<const int64_t> arguments, uint32_t slot) {
+    return slot < arguments.size() ? arguments[slot] : 0;
 }
 
-int64_t Evaluation::evaluateAssignmentExpression(const semantic_analysis::AssignmentExpression* assignmentExpression) {
-    int64_t result = evaluateArithmetic(assignmentExpression->arithmetic.get());
-    identifiers[assignmentExpression->id].value = result;
-    return result;
+/// while profiling, each call costs one comparison per parameter
+Evaluation& Speculation::choose(Evaluation& generic, std::span<const int64_t> arguments) {
+    if(specialized) {
+        bool guardsHold = true;
+        for(const auto& [slot, value] : guards) {
+            guardsHold &= getArgument(arguments, slot) == value;
+        }
+        guardedCalls++;
+        if(guardsHold) {
+            return *specialized;
+        }
+        guardFailures++;
+        // more than 1 of 16 calls miss the specialization
+        if(guardedCalls >= initialWindow && guardFailures * 16 > guardedCalls) {
+            deoptimize();
+        }
+        return generic;
+    }
+    if(window > maxWindow) {
+        // gave up on this function
+        return generic;
+    }
+    if(profiles.empty()) {
+        // parameters come first in the frame
+        size_t count = generic.getParameterCount();
+        if(count == 0) {
+            // nothing to specialize on
+            window = maxWindow + 1;
+            return generic;
+        }
+        profiles.resize(count);
+    }
+    for(uint32_t slot = 0; slot < profiles.size(); slot++) {
+        ParameterProfile& profile = profiles[slot];
+        int64_t argument = getArgument(arguments, slot);
+        if(argument == profile.candidate) {
+            profile.votes++;
+            profile.matches++;
+        } else if(profile.votes == 0) {
+            profile.candidate = argument;
+            profile.votes = 1;
+            profile.matches = 1;
+        } else {
+            profile.votes--;
+        }
+    }
+    if(++calls == window) {
+        decide(generic);
+    }
+    return generic;
 }
 
-int64_t Evaluation::evaluateArithmetic(const semantic_analysis::Arithmetic* arithmetic) {
-    // downcast depending of type of arithmetic
-    if(arithmetic->type == semantic_analysis::Arithmetic::Type::BinaryOperator) {
-        return evaluateBinaryOperator(semantic_analysis::getBinaryOperator(arithmetic));
-    } else if(arithmetic->type == semantic_analysis::Arithmetic::Type::Literal) {
-        return evaluateLiteral(semantic_analysis::getLiteral(arithmetic));
-    } else if(arithmetic->type == semantic_analysis::Arithmetic::Type::UnaryOperator) {
-        return evaluateUnaryOperator(semantic_analysis::getUnaryOperator(arithmetic));
-    } else {
-        // Identifier
-        return evaluateIdentifierNode(semantic_analysis::getIdentifier(arithmetic));
+/// a parameter counts as nearly constant if its candidate was the argument of at least 15 of 16 calls
+void Speculation::decide(const Evaluation& generic) {
+    guards.clear();
+    for(uint32_t slot = 0; slot < profiles.size(); slot++) {
+        if(static_cast<uint64_t>(profiles[slot].matches) * 16 >= static_cast<uint64_t>(calls) * 15) {
+            guards.emplace_back(slot, profiles[slot].candidate);
+        }
+    }
+    if(guards.empty()) {
+        deoptimize();
+        return;
     }
+    // the specialized version still takes all arguments, so they don't have to be rearranged after the guard
+    specialized.emplace(generic.specializeSlots(guards, true));
+    guardedCalls = 0;
+    guardFailures = 0;
 }
 
-int64_t Evaluation::evaluateBinaryOperator(const semantic_analysis::BinaryOperator* binaryOperator) {
-    // correct operator depending on type of BinaryOperator
-    if(binaryOperator->type == semantic_analysis::BinaryOperator::Type::Division) {
-        return evaluateArithmetic(binaryOperator->left.get()) / evaluateArithmetic(binaryOperator->right.get());
-    } else if(binaryOperator->type == semantic_analysis::BinaryOperator::Type::Minus) {
-        return evaluateArithmetic(binaryOperator->left.get()) - evaluateArithmetic(binaryOperator->right.get());
-    } else if(binaryOperator->type == semantic_analysis::BinaryOperator::Type::Multiplication) {
-        return evaluateArithmetic(binaryOperator->left.get()) * evaluateArithmetic(binaryOperator->right.get());
-    } else {
-        /// Plus
-        return evaluateArithmetic(binaryOperator->left.get()) + evaluateArithmetic(binaryOperator->right.get());
+/// starts profiling again with twice the window
+void Speculation::deoptimize() {
+    specialized.reset();
+    guards.clear();
+    std::fill(profiles.begin(), profiles.end(), ParameterProfile());
+    calls = 0;
+    window *= 2;
+}
+
+/// bytes on the heap owned by the speculation
+size_t Speculation::getMemoryUsage() const {
+    return profiles.capacity() * sizeof(ParameterProfile)
+        + guards.capacity() * sizeof(std::pair<uint32_t, int64_t>)
+        + (specialized ? specialized->getMemoryUsage() : 0);
+}
+
+// End: speculation
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Begin: incremental evaluation
+
+/// computes one instruction from the cached values of its operands
+int64_t IncrementalEvaluation::compute(uint32_t value) const {
+    const optimization::Instruction& instruction = program.instructions[value];
+    switch(instruction.opcode) {
+        case optimization::Instruction::Opcode::Constant:
+            return instruction.value;
+        case optimization::Instruction::Opcode::Parameter:
+            return getArgument(arguments, instruction.left);
+        default:
+            return instruction.apply(results[instruction.left], instruction.isBinary() ? results[instruction.right] : 0);
     }
 }
 
-int64_t Evaluation::evaluateUnaryOperator(const semantic_analysis::UnaryOperator* unaryOperator) {
-    // correct operator depending on type of UnaryOperator
-    if(unaryOperator->type == semantic_analysis::UnaryOperator::Type::Plus) {
-        return evaluateArithmetic(unaryOperator->next.get());
-    } else {
-        /// Minus
-        return -evaluateArithmetic(unaryOperator->next.get());
+/// program of a valid evaluation, the evaluations derived from it need one
+static const optimization::Program& compiledProgram(const Evaluation& evaluation) {
+    assert(evaluation.program && "function has compile errors");
+    return *evaluation.program;
+}
+
+/// only the parameters are kept from the frame, every other slot is an SSA value
+IncrementalEvaluation::IncrementalEvaluation(const Evaluation& evaluation, std::span<const int64_t> arguments)
+    : program(compiledProgram(evaluation)), defUse(program), arguments(arguments.begin(), arguments.end()), results(program.instructions.size()), queued(program.instructions.size(), false) {
+    const std::vector<semantic_analysis::Identifier>& identifiers = evaluation.getIdentifiers();
+    for(uint32_t i = 0; i < program.instructions.size(); i++) {
+        const optimization::Instruction& instruction = program.instructions[i];
+        if(instruction.opcode == optimization::Instruction::Opcode::Parameter) {
+            if(instruction.left >= parameterValues.size()) {
+                parameterValues.resize(instruction.left + 1, none);
+            }
+            parameterValues[instruction.left] = i;
+        }
+        results[i] = compute(i);
+    }
+    recomputed = program.instructions.size();
+    for(uint32_t slot : evaluation.getOutputSlots()) {
+        outputValues.push_back(none);
+        initialValues.push_back(identifiers[slot].value);
+        for(const optimization::Definition& definition : program.definitions) {
+            if(definition.slot == slot) {
+                outputValues.back() = definition.value;
+            }
+        }
     }
 }
 
-int64_t Evaluation::evaluateLiteral(const semantic_analysis::Literal* literal) {
-    return literal->number;
+/// users are only queued if the value really changed, e.g. nothing after a multiplication with 0 gets recomputed
+int64_t IncrementalEvaluation::update(uint32_t slot, int64_t argument) {
+    recomputed = 0;
+    if(slot >= arguments.size()) {
+        arguments.resize(slot + 1, 0);
+    }
+    arguments[slot] = argument;
+    if(slot >= parameterValues.size() || parameterValues[slot] == none) {
+        return getResult();
+    }
+    worklist.push_back(parameterValues[slot]);
+    queued[parameterValues[slot]] = true;
+    while(!worklist.empty()) {
+        std::pop_heap(worklist.begin(), worklist.end(), std::greater<>());
+        uint32_t value = worklist.back();
+        worklist.pop_back();
+        queued[value] = false;
+        int64_t result = compute(value);
+        recomputed++;
+        if(result == results[value]) {
+            continue;
+        }
+        results[value] = result;
+        for(uint32_t user : defUse.getUsers(value)) {
+            if(!queued[user]) {
+                queued[user] = true;
+                worklist.push_back(user);
+                std::push_heap(worklist.begin(), worklist.end(), std::greater<>());
+            }
+        }
+    }
+    return getResult();
 }
 
-int64_t Evaluation::evaluateIdentifierNode(const semantic_analysis::IdentifierNode* identifier) {
-    return identifiers[identifier->id].value;
+/// fills outputs like Evaluation::evaluateFunction
+void IncrementalEvaluation::getOutputs(std::span<int64_t> outputs) const {
+    assert(outputs.size() == outputValues.size() + 1 && "one output per selected variable and one for the result");
+    for(size_t i = 0; i < outputValues.size(); i++) {
+        outputs[i] = outputValues[i] == none ? initialValues[i] : results[outputValues[i]];
+    }
+    outputs.back() = getResult();
 }
 
-// End: evaluation functions
+// End: incremental evaluation
 //--------------------------------------------------------------
 
 //--------------------------------------------------------------
-// Begin: optimize functions
-
-void ConstantPropagation::optimize(std::unique_ptr<semantic_analysis::Function>& function) {
-    const semantic_analysis::Statement* statement = function->statement.get();
-    const semantic_analysis::NormalStatement* normalStatement = semantic_analysis::getNormalStatement(statement);
-    // while-loop to iterate through all statements
-    while(normalStatement != nullptr) {
-        optimize(normalStatement->expression->arithmetic);
-        statement = normalStatement->nextStatement.get();
-        normalStatement = semantic_analysis::getNormalStatement(statement);
-    }
-    semantic_analysis::ReturnStatement* returnStatement = const_cast<semantic_analysis::ReturnStatement*>(semantic_analysis::getReturnStatement(statement));
-    optimize(returnStatement->arithmetic);
-}
-
-void ConstantPropagation::optimize(std::unique_ptr<semantic_analysis::Arithmetic>& arithmetic) {
-    // if arithmetic is BinaryOperator
-    if(arithmetic->type == semantic_analysis::Arithmetic::Type::BinaryOperator) {
-        semantic_analysis::BinaryOperator* binaryOperator = const_cast<semantic_analysis::BinaryOperator*>(semantic_analysis::getBinaryOperator(arithmetic.get()));
-        // optimize childs first
-        optimize(binaryOperator->left);
-        optimize(binaryOperator->right);
-        // then if both childs are literal, combine then to a new literal depending on type of operator
-        if(binaryOperator->left->type == semantic_analysis::Arithmetic::Type::Literal && binaryOperator->right->type == semantic_analysis::Arithmetic::Type::Literal) {
-            semantic_analysis::Literal* left = const_cast<semantic_analysis::Literal*>(semantic_analysis::getLiteral(binaryOperator->left.get()));
-            semantic_analysis::Literal* right = const_cast<semantic_analysis::Literal*>(semantic_analysis::getLiteral(binaryOperator->right.get()));
-            std::unique_ptr<semantic_analysis::Literal> literal;
-            switch(binaryOperator->type) {
-                case semantic_analysis::BinaryOperator::Type::Plus:
-                    literal = std::make_unique<semantic_analysis::Literal>(left->number + right->number);
+// Begin: vectorized evaluation
+
+/// primitive over one vector, the operation is inlined into the loop
+template <typename Operation>
+static void mapUnary(const int64_t* operand, int64_t* result, size_t count, Operation operation) {
+    for(size_t i = 0; i < count; i++) {
+        result[i] = operation(operand[i]);
+    }
+}
+
+/// primitives over two vectors, or a vector and a constant on either side
+template <typename Operation>
+static void mapBinary(const int64_t* left, const int64_t* right, int64_t* result, size_t count, Operation operation) {
+    for(size_t i = 0; i < count; i++) {
+        result[i] = operation(left[i], right[i]);
+    }
+}
+template <typename Operation>
+static void mapBinary(const int64_t* left, int64_t right, int64_t* result, size_t count, Operation operation) {
+    for(size_t i = 0; i < count; i++) {
+        result[i] = operation(left[i], right);
+    }
+}
+template <typename Operation>
+static void mapBinary(int64_t left, const int64_t* right, int64_t* result, size_t count, Operation operation) {
+    for(size_t i = 0; i < count; i++) {
+        result[i] = operation(left, right[i]);
+    }
+}
+
+/// only the result is computed
+VectorizedEvaluation::VectorizedEvaluation(const Evaluation& evaluation) : VectorizedEvaluation(compiledProgram(evaluation), {compiledProgram(evaluation).result}) {}
+
+/// linear scan over the values: the vectors of operands at their last use are free again before the result gets one
+/// primitives work element by element, so a result can overwrite the vector of its operand
+VectorizedEvaluation::VectorizedEvaluation(optimization::Program compiled, std::vector<uint32_t> values)
+    : program(std::move(compiled)), outputValues(std::move(values)), vectorOf(program.instructions.size(), none) {
+    const std::vector<optimization::Instruction>& instructions = program.instructions;
+    std::vector<uint32_t> lastUse(instructions.size(), 0);
+    for(uint32_t i = 0; i < instructions.size(); i++) {
+        const optimization::Instruction& instruction = instructions[i];
+        if(instruction.isUnary() || instruction.isBinary()) {
+            lastUse[instruction.left] = i;
+        }
+        if(instruction.isBinary()) {
+            lastUse[instruction.right] = i;
+        }
+        if(instruction.opcode == optimization::Instruction::Opcode::Parameter) {
+            parameterCount = std::max<size_t>(parameterCount, instruction.left + 1);
+        }
+    }
+    // the outputs are read after the last instruction
+    for(uint32_t value : outputValues) {
+        lastUse[value] = none;
+    }
+    std::vector<uint32_t> free;
+    auto release = [&](uint32_t value, uint32_t i) {
+        if(vectorOf[value] != none && lastUse[value] == i) {
+            free.push_back(vectorOf[value]);
+            // an operand used twice is only released once
+            lastUse[value] = none;
+        }
+    };
+    for(uint32_t i = 0; i < instructions.size(); i++) {
+        const optimization::Instruction& instruction = instructions[i];
+        if(!instruction.isUnary() && !instruction.isBinary()) {
+            continue;
+        }
+        release(instruction.left, i);
+        if(instruction.isBinary()) {
+            release(instruction.right, i);
+        }
+        if(free.empty()) {
+            free.push_back(vectorCount++);
+        }
+        vectorOf[i] = free.back();
+        free.pop_back();
+    }
+    scratch.resize(vectorCount * vectorSize);
+}
+
+/// evaluates one row per result
+size_t VectorizedEvaluation::evaluate(std::span<const std::span<const int64_t>> columns, std::span<int64_t> results) {
+    assert(outputValues.size() == 1 && "one output column per output value");
+    return evaluate(columns, std::span(&results, 1));
+}
+
+/// one primitive call per instruction and vector of rows
+/// a division which would trap cuts the vector off in front of its row, so the later instructions only compute the rows before it
+size_t VectorizedEvaluation::evaluate(std::span<const std::span<const int64_t>> columns, std::span<const std::span<int64_t>> outputs) {
+    using Opcode = optimization::Instruction::Opcode;
+    assert(columns.size() >= parameterCount && "one column per parameter");
+    assert(outputs.size() == outputValues.size() && "one output column per output value");
+    const std::vector<optimization::Instruction>& instructions = program.instructions;
+    size_t rowCount = outputs.empty() ? 0 : outputs[0].size();
+    for(size_t begin = 0; begin < rowCount; begin += vectorSize) {
+        size_t vectorRows = std::min(vectorSize, rowCount - begin);
+        size_t count = vectorRows;
+        // rows of the value in this vector, nullptr for constants
+        auto rows = [&](uint32_t value) -> const int64_t* {
+            const optimization::Instruction& instruction = instructions[value];
+            if(instruction.opcode == Opcode::Parameter) {
+                assert(columns[instruction.left].size() >= rowCount && "one argument per row");
+                return columns[instruction.left].data() + begin;
+            }
+            if(instruction.isConstant()) {
+                return nullptr;
+            }
+            return scratch.data() + vectorOf[value] * vectorSize;
+        };
+        for(uint32_t i = 0; i < instructions.size(); i++) {
+            const optimization::Instruction& instruction = instructions[i];
+            if(!instruction.isUnary() && !instruction.isBinary()) {
+                continue;
+            }
+            int64_t* result = scratch.data() + vectorOf[i] * vectorSize;
+            const int64_t* left = rows(instruction.left);
+            if(instruction.isUnary()) {
+                if(!left) {
+                    std::fill_n(result, count, instruction.apply(instructions[instruction.left].value, 0));
+                    continue;
+                }
+                switch(instruction.opcode) {
+                    case Opcode::Negate:
+                        mapUnary(left, result, count, [](int64_t x) { return static_cast<int64_t>(0 - static_cast<uint64_t>(x)); });
+                        break;
+                    case Opcode::ShiftLeft:
+                        mapUnary(left, result, count, [shift = instruction.shift](int64_t x) { return static_cast<int64_t>(static_cast<uint64_t>(x) << shift); });
+                        break;
+                    default:
+                        // the divisions by constants need their immediates
+                        mapUnary(left, result, count, [&instruction](int64_t x) { return instruction.apply(x, 0); });
+                        break;
+                }
+                continue;
+            }
+            const int64_t* right = rows(instruction.right);
+            auto dispatch = [&](auto operation) {
+                if(left && right) {
+                    mapBinary(left, right, result, count, operation);
+                } else if(left) {
+                    mapBinary(left, instructions[instruction.right].value, result, count, operation);
+                } else if(right) {
+                    mapBinary(instructions[instruction.left].value, right, result, count, operation);
+                } else {
+                    // only divisions which trap keep two constant operands
+                    std::fill_n(result, count, operation(instructions[instruction.left].value, instructions[instruction.right].value));
+                }
+            };
+            switch(instruction.opcode) {
+                case Opcode::Add:
+                    dispatch([](int64_t l, int64_t r) { return static_cast<int64_t>(static_cast<uint64_t>(l) + static_cast<uint64_t>(r)); });
                     break;
-                case semantic_analysis::BinaryOperator::Type::Minus:
-                    literal = std::make_unique<semantic_analysis::Literal>(left->number - right->number);
+                case Opcode::Subtract:
+                    dispatch([](int64_t l, int64_t r) { return static_cast<int64_t>(static_cast<uint64_t>(l) - static_cast<uint64_t>(r)); });
                     break;
-                case semantic_analysis::BinaryOperator::Type::Division:
-                    literal = std::make_unique<semantic_analysis::Literal>(left->number / right->number);
+                case Opcode::Multiply:
+                    dispatch([](int64_t l, int64_t r) { return static_cast<int64_t>(static_cast<uint64_t>(l) * static_cast<uint64_t>(r)); });
                     break;
-                case semantic_analysis::BinaryOperator::Type::Multiplication:
-                    literal = std::make_unique<semantic_analysis::Literal>(left->number * right->number);
+                default: {
+                    int64_t leftConstant = instructions[instruction.left].value;
+                    int64_t rightConstant = instructions[instruction.right].value;
+                    size_t safe = 0;
+                    while(safe < count && !optimization::Instruction::divisionTraps(left ? left[safe] : leftConstant, right ? right[safe] : rightConstant)) {
+                        safe++;
+                    }
+                    count = safe;
+                    if(count > 0) {
+                        dispatch([](int64_t l, int64_t r) { return l / r; });
+                    }
                     break;
+                }
             }
-            arithmetic = std::move(literal);
-        }
-    // if arithmetic is UnaryOperator
-    } else if(arithmetic->type == semantic_analysis::Arithmetic::Type::UnaryOperator) {
-        semantic_analysis::UnaryOperator* unaryOperator = const_cast<semantic_analysis::UnaryOperator*>(semantic_analysis::getUnaryOperator(arithmetic.get()));
-        // optimize child first
-        optimize(unaryOperator->next);
-        // if child is literal, create new literal depending on type of UnaryOperator
-        if(unaryOperator->next->type == semantic_analysis::Arithmetic::Type::Literal) {
-            semantic_analysis::Literal* next = const_cast<semantic_analysis::Literal*>(semantic_analysis::getLiteral(unaryOperator->next.get()));
-            std::unique_ptr<semantic_analysis::Literal> literal;
-            switch(unaryOperator->type) {
-                case semantic_analysis::UnaryOperator::Type::Plus:
-                    literal = std::make_unique<semantic_analysis::Literal>(next->number);
-                    break;
-                case semantic_analysis::UnaryOperator::Type::Minus:
-                    literal = std::make_unique<semantic_analysis::Literal>(-next->number);
-                    break;
+        }
+        for(size_t o = 0; o < outputValues.size(); o++) {
+            assert(outputs[o].size() == rowCount && "same number of rows for all outputs");
+            const int64_t* result = rows(outputValues[o]);
+            if(result) {
+                std::copy_n(result, count, outputs[o].data() + begin);
+            } else {
+                std::fill_n(outputs[o].data() + begin, count, instructions[outputValues[o]].value);
             }
-            arithmetic = std::move(literal);
+        }
+        if(count < vectorRows) {
+            return begin + count;
         }
     }
+    return rowCount;
 }
 
-// End: optimize functions
+// End: vectorized evaluation
 //--------------------------------------------------------------
 
-/// constructor calls optimization methods after creating function
-Evaluation::Evaluation(CodeManager& codeManager) : semanticAnalyser(codeManager), function(semanticAnalyser.analyseFunction()) {
-    ConstantPropagation constantPropagation;
-    constantPropagation.optimize(function);
-}
-
 } // namespace execution
-//--------------------------------------------------------------
\ No newline at end of file
+//--------------------------------------------------------------
@@ -1,6 +1,12 @@
 #ifndef H_5_execution
 #define H_5_execution
 #include "4_semantic_analysis.hpp"
+#include "5_optimization.hpp"
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
 //--------------------------------------------------------------
 namespace execution {
 
@@ -8,43 +14,175 @@ namespace execution {
  * most important class is evaluation, which provides method to execute a function
  */
 
+/// only keeps the optimized Program and the identifiers of its frame, everything else of the compilation is freed after construction
 class Evaluation {
     private:
+    /// identifiers of the frame: all parameters and the slots the program still writes
+    /// index is the slot, also used as debug map
     std::vector<semantic_analysis::Identifier> identifiers;
-    semantic_analysis::SemanticAnalyser semanticAnalyser;
+    /// values of the identifiers during evaluation
+    std::vector<int64_t> values;
+    /// reused buffer for the results of the instructions, index is the value
+    std::vector<int64_t> results;
+    /// slots of the variables which are given back besides the result, in the order they were selected
+    std::vector<uint32_t> outputSlots;
+    /// number of parameters, they are the first slots of the frame
+    size_t parameterCount = 0;
+    /// true if the result doesn't depend on the arguments and nothing else is written, calls only load it
+    bool constant = false;
     public:
-    std::unique_ptr<semantic_analysis::Function> function;
-    /// constructor
-    explicit Evaluation(CodeManager& codeManager);
-    /// saves all symbols in an array with id as index
-    void evaluateSymbols(std::initializer_list<int64_t> list);
+    /// nullopt if the code is invalid
+    std::optional<optimization::Program> program;
+    /// constructor, compile errors get reported to the diagnostics
+    /// names get interned into the NamePool if there is one, statistics of the passes go into the report if there is one
+    /// the final values of the variables named in outputs are kept, so they can be given back by each evaluation
+    Evaluation(const CodeManager& codeManager, Diagnostics& diagnostics, code_management::NamePool* namePool = nullptr, optimization::CompileReport* report = nullptr, std::span<const std::string_view> outputs = {});
+    /// copy with the named parameters fixed to values, the program gets optimized again and only takes the other parameters
+    /// an unknown name or an invalid evaluation gets reported to the diagnostics and gives back an invalid evaluation
+    Evaluation specialize(std::span<const std::pair<std::string_view, int64_t>> bindings, Diagnostics& diagnostics) const;
+    /// copy with the parameters in the slots fixed to values
+    /// if keepParameters is set, the copy still takes all arguments and ignores the ones of the bound slots
+    Evaluation specializeSlots(std::span<const std::pair<uint32_t, int64_t>> bindings, bool keepParameters) const;
+    /// gives back the identifiers of the frame, parameters come first
+    const std::vector<semantic_analysis::Identifier>& getIdentifiers() const { return identifiers; }
+    /// number of arguments the function takes
+    size_t getParameterCount() const { return parameterCount; }
+    /// bytes on the heap owned by the evaluation (instructions + buffers)
+    size_t getMemoryUsage() const;
+    /// saves all symbols in an array with id as index, missing arguments are 0 like the initial value of parameters
+    void evaluateSymbols(std::span<const int64_t> arguments);
     /// evaluation function for all AST-node types
-    int64_t evaluateFunction(std::initializer_list<int64_t> list);
+    int64_t evaluateFunction(std::initializer_list<int64_t> list) { return evaluateFunction(std::span(list.begin(), list.size())); }
+    int64_t evaluateFunction(std::span<const int64_t> arguments);
+    /// evaluates once and fills outputs with the final values of the selected variables, followed by the result
+    void evaluateFunction(std::span<const int64_t> arguments, std::span<int64_t> outputs);
+    /// number of values written by the multi-output evaluation, the selected variables plus the result
+    size_t getOutputCount() const { return outputSlots.size() + 1; }
+    /// slots of the selected variables in the frame
+    std::span<const uint32_t> getOutputSlots() const { return outputSlots; }
+    /// true if every call gives back the same value, e.g. for functions without parameters
+    bool isConstant() const { return constant; }
+    /// the value of a constant function
+    int64_t getConstant() const { return program->instructions[program->result].value; }
     private:
-    int64_t evaluateStatement(const semantic_analysis::Statement* statement);
-    int64_t evaluateReturnStatement(const semantic_analysis::ReturnStatement* returnStatement);
-    int64_t evaluateNormalStatement(const semantic_analysis::NormalStatement* normalStatement);
-    int64_t evaluateAssignmentExpression(const semantic_analysis::AssignmentExpression* assignmentExpression);
-    int64_t evaluateArithmetic(const semantic_analysis::Arithmetic* arithmetic);
-    int64_t evaluateBinaryOperator(const semantic_analysis::BinaryOperator* binaryOperator);
-    int64_t evaluateUnaryOperator(const semantic_analysis::UnaryOperator* unaryOperator);
-    int64_t evaluateLiteral(const semantic_analysis::Literal* literal);
-    int64_t evaluateIdentifierNode(const semantic_analysis::IdentifierNode* identifier);
+    /// evaluation without program, filled by specialize
+    Evaluation() = default;
+    /// runs the pipeline, keeping the final values of the output slots
+    void optimize(optimization::CompileReport* report);
+    /// removes the slots of unused variables and constants from the frame
+    void compactFrame();
+    int64_t evaluateProgram();
 };
 
-class Optimization {
+/// records value profiles of the arguments and specializes the evaluation on parameters which are nearly constant
+/// the specialized version runs behind a guard which compares the arguments of the bound parameters with their values
+/// if the guard fails too often, the specialization gets dropped and the profiling starts again with a longer window
+class Speculation {
     public:
-    virtual void optimize(std::unique_ptr<semantic_analysis::Function>& function) = 0;
+    /// calls profiled before the first decision, each failed speculation doubles the window
+    static constexpr uint32_t initialWindow = 1024;
+    static constexpr uint32_t maxWindow = 1u << 20;
+    private:
+    /// Boyer-Moore majority vote over the arguments of one parameter
+    struct ParameterProfile {
+        int64_t candidate = 0;
+        uint32_t votes = 0;
+        /// calls whose argument was the current candidate
+        uint32_t matches = 0;
+    };
+    std::vector<ParameterProfile> profiles;
+    uint32_t window = initialWindow;
+    uint32_t calls = 0;
+    /// bound slots and their values, checked before each call of the specialized version
+    std::vector<std::pair<uint32_t, int64_t>> guards;
+    std::optional<Evaluation> specialized;
+    uint32_t guardedCalls = 0;
+    uint32_t guardFailures = 0;
+    /// parameters bound to the values of nearly all profiled calls
+    void decide(const Evaluation& generic);
+    void deoptimize();
+    public:
+    /// records the arguments and gives back the version to call with them, the specialized one if the guards hold
+    Evaluation& choose(Evaluation& generic, std::span<const int64_t> arguments);
+    /// calls the version chosen for the arguments
+    int64_t evaluate(Evaluation& generic, std::span<const int64_t> arguments) { return choose(generic, arguments).evaluateFunction(arguments); }
+    /// nullptr while there is no specialized version
+    const Evaluation* getSpecialized() const { return specialized ? &*specialized : nullptr; }
+    /// bytes on the heap owned by the speculation
+    size_t getMemoryUsage() const;
 };
 
-/// already implemented dead code elimination in Milestone 2, parser ignores everything after "."
-class DeadCodeElimination {};
+/// stateful evaluation for callers which change a few parameters between calls
+/// caches the value of every instruction and only recomputes the instructions which depend on changed parameters
+/// the dependencies are the users of each value in the optimized program, which is the lowered AST
+/// the evaluation has to outlive the context and must not be recompiled meanwhile
+class IncrementalEvaluation {
+    private:
+    const optimization::Program& program;
+    optimization::DefUse defUse;
+    std::vector<int64_t> arguments;
+    /// value of each instruction
+    std::vector<int64_t> results;
+    /// Parameter instruction of each parameter, none if the program doesn't read it
+    std::vector<uint32_t> parameterValues;
+    /// value of each selected variable, none if it is never assigned
+    std::vector<uint32_t> outputValues;
+    /// initial values of the selected variables
+    std::vector<int64_t> initialValues;
+    /// instructions to recompute, smallest index first, so operands are always up to date
+    std::vector<uint32_t> worklist;
+    std::vector<bool> queued;
+    size_t recomputed = 0;
+    static constexpr uint32_t none = ~0u;
+    /// computes one instruction from the cached values of its operands
+    int64_t compute(uint32_t value) const;
+    public:
+    /// constructor, evaluates the whole program once, the evaluation has to be valid
+    IncrementalEvaluation(const Evaluation& evaluation, std::span<const int64_t> arguments);
+    /// sets the argument of the parameter in the slot and recomputes everything which depends on it, gives back the result
+    int64_t update(uint32_t slot, int64_t argument);
+    /// result of the current arguments
+    int64_t getResult() const { return results[program.result]; }
+    /// fills outputs like Evaluation::evaluateFunction
+    void getOutputs(std::span<int64_t> outputs) const;
+    /// number of instructions computed by the last update, the whole program for the constructor
+    size_t getRecomputedCount() const { return recomputed; }
+};
 
-class ConstantPropagation : public Optimization {
+/// vector-at-a-time interpreter (MonetDB/X100): each instruction is a primitive which processes vectorSize rows at once
+/// intermediate vectors live in a few scratch vectors, a value gives its vector to later ones after its last use
+/// parameters are read directly from the argument columns and constants are operands of the primitives, so neither needs a vector
+class VectorizedEvaluation {
     public:
-    void optimize(std::unique_ptr<semantic_analysis::Function>& function) override;
+    /// rows per primitive call, 1024 rows of 8 bytes keep a few vectors in the L1/L2 cache
+    static constexpr size_t vectorSize = 1024;
     private:
-    void optimize(std::unique_ptr<semantic_analysis::Arithmetic>& arithmetic);
+    optimization::Program program;
+    /// values written to the output columns, the result of the program if nothing else is given
+    std::vector<uint32_t> outputValues;
+    static constexpr uint32_t none = ~0u;
+    /// scratch vector of each value, none for parameters and constants
+    std::vector<uint32_t> vectorOf;
+    /// vectorCount * vectorSize values
+    std::vector<int64_t> scratch;
+    size_t vectorCount = 0;
+    /// number of argument columns needed
+    size_t parameterCount = 0;
+    public:
+    /// constructor for the result of the evaluation, outputs of variables are not computed, the evaluation has to be valid
+    explicit VectorizedEvaluation(const Evaluation& evaluation);
+    /// constructor for several values of one program, e.g. the results of fused functions
+    VectorizedEvaluation(optimization::Program program, std::vector<uint32_t> outputValues);
+    /// evaluates one row per result, arguments are column-major: the argument of parameter p in row r is columns[p][r]
+    /// instead of trapping, the evaluation stops at the first row with a division by 0 (or of INT64_MIN by -1)
+    /// gives back the number of rows in front of it, all rows if no division traps
+    size_t evaluate(std::span<const std::span<const int64_t>> columns, std::span<int64_t> results);
+    /// same for all output values, outputs[o][r] is output o of row r, all rows in one pass over the columns
+    size_t evaluate(std::span<const std::span<const int64_t>> columns, std::span<const std::span<int64_t>> outputs);
+    /// number of scratch vectors
+    size_t getVectorCount() const { return vectorCount; }
+    /// the executed program
+    const optimization::Program& getProgram() const { return program; }
 };
 
 } // namespace execution
@@ -0,0 +1,789 @@
+#include "4_semantic_analysis.hpp"
+#include "5_optimization.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+//--------------------------------------------------------------
+namespace optimization {
+
+/// appends instruction, gives back its value
+uint32_t Program::addInstruction(Instruction instruction) {
+    instructions.push_back(instruction);
+    return static_cast<uint32_t>(instructions.size() - 1);
+}
+
+/// walks the nodes of each statement in order, the current version of each slot is the value of its last assignment
+Program::Program(const semantic_analysis::Function& function, std::span<const semantic_analysis::Identifier> identifiers) {
+    using semantic_analysis::Node;
+    constexpr uint32_t none = ~0u;
+    // value of each node of the AST
+    std::vector<uint32_t> valueOf(function.nodes.size());
+    // current version of each slot
+    std::vector<uint32_t> current(identifiers.size(), none);
+    instructions.reserve(function.nodes.size());
+    for(const semantic_analysis::Statement& statement : function.statements) {
+        for(uint32_t i = statement.begin; i < statement.end; i++) {
+            const Node& node = function.nodes[i];
+            switch(node.type) {
+                case Node::Type::Literal:
+                    valueOf[i] = addInstruction(Instruction::constant(node.number));
+                    break;
+                case Node::Type::Identifier:
+                    // first read of a slot, parameters come from the frame, variables have their initial value
+                    if(current[node.left] == none) {
+                        if(identifiers[node.left].type == semantic_analysis::Identifier::Type::Parameter) {
+                            current[node.left] = addInstruction(Instruction::parameter(node.left));
+                        } else {
+                            current[node.left] = addInstruction(Instruction::constant(identifiers[node.left].value));
+                        }
+                    }
+                    valueOf[i] = current[node.left];
+                    break;
+                case Node::Type::UnaryPlus:
+                    valueOf[i] = valueOf[node.left];
+                    break;
+                case Node::Type::UnaryMinus:
+                    valueOf[i] = addInstruction(Instruction::unary(Instruction::Opcode::Negate, valueOf[node.left]));
+                    break;
+                case Node::Type::Plus:
+                    valueOf[i] = addInstruction(Instruction::binary(Instruction::Opcode::Add, valueOf[node.left], valueOf[node.right]));
+                    break;
+                case Node::Type::Minus:
+                    valueOf[i] = addInstruction(Instruction::binary(Instruction::Opcode::Subtract, valueOf[node.left], valueOf[node.right]));
+                    break;
+                case Node::Type::Multiplication:
+                    valueOf[i] = addInstruction(Instruction::binary(Instruction::Opcode::Multiply, valueOf[node.left], valueOf[node.right]));
+                    break;
+                case Node::Type::Division:
+                    valueOf[i] = addInstruction(Instruction::binary(Instruction::Opcode::Divide, valueOf[node.left], valueOf[node.right]));
+                    break;
+            }
+        }
+        if(statement.isReturn()) {
+            result = valueOf[statement.root()];
+        } else {
+            current[statement.target] = valueOf[statement.root()];
+            definitions.push_back({statement.target, valueOf[statement.root()]});
+        }
+    }
+}
+
+/// marks the values backwards from the definitions and the result, then moves the used ones to the front
+/// divisions which could trap are kept with their operands, even if nothing uses them, so they still trap when they get executed
+void Program::removeUnused() {
+    std::vector<bool> used(instructions.size(), false);
+    used[result] = true;
+    for(const Definition& definition : definitions) {
+        used[definition.value] = true;
+    }
+    for(size_t i = instructions.size(); i > 0; i--) {
+        const Instruction& instruction = instructions[i - 1];
+        if(instruction.opcode == Instruction::Opcode::Divide) {
+            // only a constant divisor which traps for no dividend, not even INT64_MIN, makes the division safe
+            const Instruction& divisor = instructions[instruction.right];
+            used[i - 1] = used[i - 1] || !divisor.isConstant() || Instruction::divisionTraps(INT64_MIN, divisor.value);
+        }
+        if(!used[i - 1]) {
+            continue;
+        }
+        if(instruction.isUnary() || instruction.isBinary()) {
+            used[instruction.left] = true;
+        }
+        if(instruction.isBinary()) {
+            used[instruction.right] = true;
+        }
+    }
+    std::vector<uint32_t> newValue(instructions.size());
+    uint32_t size = 0;
+    for(size_t i = 0; i < instructions.size(); i++) {
+        if(!used[i]) {
+            continue;
+        }
+        Instruction instruction = instructions[i];
+        if(instruction.isUnary() || instruction.isBinary()) {
+            instruction.left = newValue[instruction.left];
+        }
+        if(instruction.isBinary()) {
+            instruction.right = newValue[instruction.right];
+        }
+        newValue[i] = size;
+        instructions[size++] = instruction;
+    }
+    instructions.resize(size);
+    for(Definition& definition : definitions) {
+        definition.value = newValue[definition.value];
+    }
+    result = newValue[result];
+}
+
+/// moves the slots to new positions in the frame, only parameters and definitions refer to slots
+void Program::renumberSlots(std::span<const uint32_t> newSlot) {
+    for(Instruction& instruction : instructions) {
+        if(instruction.opcode == Instruction::Opcode::Parameter) {
+            instruction.left = newSlot[instruction.left];
+        }
+    }
+    for(Definition& definition : definitions) {
+        definition.slot = newSlot[definition.slot];
+    }
+}
+
+/// parameters are only read once, by their Parameter instruction
+void Program::bindParameter(uint32_t slot, int64_t value) {
+    for(Instruction& instruction : instructions) {
+        if(instruction.opcode == Instruction::Opcode::Parameter && instruction.left == slot) {
+            instruction = Instruction::constant(value);
+        }
+    }
+}
+
+/// the operands of the other program move behind the existing instructions
+uint32_t Program::append(const Program& other, std::span<const uint32_t> newSlot) {
+    uint32_t offset = static_cast<uint32_t>(instructions.size());
+    for(Instruction instruction : other.instructions) {
+        if(instruction.opcode == Instruction::Opcode::Parameter) {
+            instruction.left = newSlot[instruction.left];
+        }
+        if(instruction.isUnary() || instruction.isBinary()) {
+            instruction.left += offset;
+        }
+        if(instruction.isBinary()) {
+            instruction.right += offset;
+        }
+        instructions.push_back(instruction);
+    }
+    return other.result + offset;
+}
+
+/// prints one instruction per line, e.g. "%3 = mul %1, %2"
+void Program::print(std::ostream& out, std::span<const semantic_analysis::Identifier> identifiers) const {
+    for(size_t i = 0; i < instructions.size(); i++) {
+        const Instruction& instruction = instructions[i];
+        out << "%" << i << " = ";
+        switch(instruction.opcode) {
+            case Instruction::Opcode::Constant: out << instruction.value; break;
+            case Instruction::Opcode::Parameter: out << "param " << identifiers[instruction.left].name; break;
+            case Instruction::Opcode::Negate: out << "neg %" << instruction.left; break;
+            case Instruction::Opcode::ShiftLeft: out << "shl %" << instruction.left << ", " << unsigned(instruction.shift); break;
+            case Instruction::Opcode::DivideByPowerOfTwo:
+                out << "div %" << instruction.left << ", " << ((instruction.flags & Instruction::negateFlag) ? "-" : "") << "2^" << unsigned(instruction.shift);
+                break;
+            case Instruction::Opcode::DivideByConstant:
+                out << "div %" << instruction.left << ", magic " << instruction.value << " >> " << unsigned(instruction.shift);
+                break;
+            case Instruction::Opcode::Add: out << "add %" << instruction.left << ", %" << instruction.right; break;
+            case Instruction::Opcode::Subtract: out << "sub %" << instruction.left << ", %" << instruction.right; break;
+            case Instruction::Opcode::Multiply: out << "mul %" << instruction.left << ", %" << instruction.right; break;
+            case Instruction::Opcode::Divide: out << "div %" << instruction.left << ", %" << instruction.right; break;
+        }
+        out << "\n";
+    }
+    for(const Definition& definition : definitions) {
+        out << identifiers[definition.slot].name << " := %" << definition.value << "\n";
+    }
+    out << "return %" << result << "\n";
+}
+
+/// counts the users of each value first, then fills them in
+DefUse::DefUse(const Program& program) : begins(program.instructions.size() + 1, 0), observed(program.instructions.size(), false) {
+    for(const Instruction& instruction : program.instructions) {
+        if(instruction.isUnary() || instruction.isBinary()) {
+            begins[instruction.left + 1]++;
+        }
+        if(instruction.isBinary()) {
+            begins[instruction.right + 1]++;
+        }
+    }
+    for(size_t i = 1; i < begins.size(); i++) {
+        begins[i] += begins[i - 1];
+    }
+    users.resize(begins.back());
+    std::vector<uint32_t> next(begins.begin(), begins.end() - 1);
+    for(uint32_t i = 0; i < program.instructions.size(); i++) {
+        const Instruction& instruction = program.instructions[i];
+        if(instruction.isUnary() || instruction.isBinary()) {
+            users[next[instruction.left]++] = i;
+        }
+        if(instruction.isBinary()) {
+            users[next[instruction.right]++] = i;
+        }
+    }
+    for(const Definition& definition : program.definitions) {
+        observed[definition.value] = true;
+    }
+    observed[program.result] = true;
+}
+
+/// instructions which use the value as operand, in order
+std::span<const uint32_t> DefUse::getUsers(uint32_t value) const {
+    return std::span<const uint32_t>(users).subspan(begins[value], begins[value + 1] - begins[value]);
+}
+
+/// true if any instruction, definition or the result uses the value
+bool DefUse::isUsed(uint32_t value) const {
+    return observed[value] || begins[value + 1] != begins[value];
+}
+
+/// passes run in the same order for every program, so the same pass and round are usually found at the same position
+void CompileReport::merge(const CompileReport& other) {
+    for(size_t i = 0; i < other.passes.size(); i++) {
+        const PassStatistics& statistics = other.passes[i];
+        PassStatistics* target = nullptr;
+        auto same = [&](const PassStatistics& candidate) {
+            return candidate.round == statistics.round && candidate.position == statistics.position && candidate.name == statistics.name;
+        };
+        if(i < passes.size() && same(passes[i])) {
+            target = &passes[i];
+        } else {
+            for(PassStatistics& candidate : passes) {
+                if(same(candidate)) {
+                    target = &candidate;
+                    break;
+                }
+            }
+        }
+        if(!target) {
+            target = &passes.emplace_back();
+            target->name = statistics.name;
+            target->round = statistics.round;
+            target->position = statistics.position;
+        }
+        target->runs += statistics.runs;
+        target->time += statistics.time;
+        target->instructionsBefore += statistics.instructionsBefore;
+        target->instructionsAfter += statistics.instructionsAfter;
+        target->rewrites += statistics.rewrites;
+    }
+    programs += other.programs;
+}
+
+/// prints one line per pass and round, followed by its dump
+void CompileReport::print(std::ostream& out) const {
+    out << programs << " programs\n";
+    for(const PassStatistics& statistics : passes) {
+        out << "round " << statistics.round << " " << statistics.name << ": " << statistics.runs << " runs, "
+            << std::chrono::duration_cast<std::chrono::microseconds>(statistics.time).count() << " us, "
+            << statistics.instructionsBefore << " -> " << statistics.instructionsAfter << " instructions, "
+            << statistics.rewrites << " rewrites\n";
+        out << statistics.dump;
+    }
+}
+
+/// appends pass to the pipeline
+void PassManager::addPass(std::unique_ptr<Optimization> pass) {
+    passes.push_back(std::move(pass));
+}
+
+/// runs all passes in order, each one sees the program without the values its predecessor made unused
+/// later passes expose new chances for earlier ones, e.g. GVN merges operands which simplification can cancel then
+void PassManager::run(Program& program, CompileReport* report, std::span<const semantic_analysis::Identifier> identifiers) {
+    auto runPass = [&](Optimization& pass, unsigned round, unsigned position) {
+        if(!report) {
+            pass.optimize(program);
+            program.removeUnused();
+            return;
+        }
+        PassStatistics statistics;
+        statistics.name = pass.getName();
+        statistics.round = round;
+        statistics.position = position;
+        statistics.runs = 1;
+        statistics.instructionsBefore = program.instructions.size();
+        pass.takeRewrites();
+        auto begin = std::chrono::steady_clock::now();
+        pass.optimize(program);
+        program.removeUnused();
+        statistics.time = std::chrono::steady_clock::now() - begin;
+        statistics.instructionsAfter = program.instructions.size();
+        statistics.rewrites = pass.takeRewrites();
+        if(report->dumpPrograms) {
+            assert(!identifiers.empty() && "dumps need the identifiers");
+            std::ostringstream out;
+            program.print(out, identifiers);
+            statistics.dump = std::move(out).str();
+        }
+        report->passes.push_back(std::move(statistics));
+    };
+    unsigned round = 0;
+    while(round < maxRounds) {
+        Program previous = program;
+        for(unsigned i = 0; i < passes.size(); i++) {
+            runPass(*passes[i], round, i);
+        }
+        round++;
+        if(program == previous) {
+            break;
+        }
+    }
+    for(unsigned i = 0; i < finalPasses.size(); i++) {
+        runPass(*finalPasses[i], round, passes.size() + i);
+    }
+    if(report) {
+        report->programs++;
+    }
+}
+
+/// appends pass which runs once after the pipeline reached its fixpoint
+void PassManager::addFinalPass(std::unique_ptr<Optimization> pass) {
+    finalPasses.push_back(std::move(pass));
+}
+
+/// pipeline used for compilation
+PassManager PassManager::createDefault(std::vector<uint32_t> observedSlots) {
+    PassManager passManager(4);
+    passManager.addPass(std::make_unique<DeadCodeElimination>(std::move(observedSlots)));
+    passManager.addPass(std::make_unique<ConstantPropagation>());
+    passManager.addPass(std::make_unique<GlobalValueNumbering>());
+    passManager.addPass(std::make_unique<AlgebraicSimplification>());
+    // simplification creates duplicate constants and exposes new common subexpressions
+    passManager.addPass(std::make_unique<GlobalValueNumbering>());
+    passManager.addFinalPass(std::make_unique<TreeHeightReduction>());
+    // chains in canonical order can share parts now
+    passManager.addFinalPass(std::make_unique<GlobalValueNumbering>());
+    return passManager;
+}
+
+/// walks the definitions backwards, so the first one seen of each observed slot is its final version
+void DeadCodeElimination::optimize(Program& program) {
+    std::vector<bool> observed;
+    for(uint32_t slot : observedSlots) {
+        if(slot >= observed.size()) {
+            observed.resize(slot + 1, false);
+        }
+        observed[slot] = true;
+    }
+    std::vector<Definition> definitions;
+    for(size_t i = program.definitions.size(); i > 0; i--) {
+        const Definition& definition = program.definitions[i - 1];
+        if(definition.slot < observed.size() && observed[definition.slot]) {
+            definitions.push_back(definition);
+            // earlier versions of the slot are overwritten
+            observed[definition.slot] = false;
+        }
+    }
+    rewrites += program.definitions.size() - definitions.size();
+    program.definitions.assign(definitions.rbegin(), definitions.rend());
+}
+
+/// key of an instruction: opcode, immediates, left operand and right operand or constant
+struct ValueKey {
+    Instruction::Opcode opcode;
+    uint16_t immediates;
+    uint32_t left;
+    int64_t payload;
+    bool operator==(const ValueKey& other) const { return opcode == other.opcode && immediates == other.immediates && left == other.left && payload == other.payload; }
+};
+
+/// hash for ValueKey
+struct ValueKeyHash {
+    size_t operator()(const ValueKey& key) const {
+        size_t hash = std::hash<int64_t>{}(key.payload);
+        hash ^= (static_cast<size_t>(key.left) << 24 | static_cast<size_t>(key.immediates) << 8 | static_cast<size_t>(key.opcode)) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
+/// operands come before their users, so their value numbers are known when an instruction is looked up
+/// duplicates are not removed here, they become unused once nothing refers to them anymore
+void GlobalValueNumbering::optimize(Program& program) {
+    std::vector<Instruction>& instructions = program.instructions;
+    // value number of each value, the first instruction computing it
+    std::vector<uint32_t> number(instructions.size());
+    std::unordered_map<ValueKey, uint32_t, ValueKeyHash> numbers;
+    numbers.reserve(instructions.size());
+    for(uint32_t i = 0; i < instructions.size(); i++) {
+        Instruction& instruction = instructions[i];
+        ValueKey key{instruction.opcode, static_cast<uint16_t>(instruction.shift | instruction.flags << 8), instruction.left, instruction.value};
+        if(instruction.isUnary() || instruction.isBinary()) {
+            instruction.left = number[instruction.left];
+            key.left = instruction.left;
+        }
+        if(instruction.isBinary()) {
+            instruction.right = number[instruction.right];
+            uint32_t left = instruction.left;
+            uint32_t right = instruction.right;
+            // a + b and b + a compute the same value
+            if((instruction.opcode == Instruction::Opcode::Add || instruction.opcode == Instruction::Opcode::Multiply) && right < left) {
+                std::swap(left, right);
+            }
+            key.left = left;
+            key.payload = right;
+        }
+        number[i] = numbers.try_emplace(key, i).first->second;
+        rewrites += number[i] != i;
+    }
+    for(Definition& definition : program.definitions) {
+        definition.value = number[definition.value];
+    }
+    program.result = number[program.result];
+}
+
+/// an instruction is inside a chain if its only user has the same operation and nothing else observes it
+/// the chains are rebuilt at their roots from their leaves, pairing neighbours level by level
+void TreeHeightReduction::optimize(Program& program) {
+    const std::vector<Instruction>& instructions = program.instructions;
+    DefUse defUse(program);
+    auto isChain = [](const Instruction& instruction) {
+        return instruction.opcode == Instruction::Opcode::Add || instruction.opcode == Instruction::Opcode::Multiply;
+    };
+    std::vector<bool> inner(instructions.size(), false);
+    for(uint32_t i = 0; i < instructions.size(); i++) {
+        std::span<const uint32_t> users = defUse.getUsers(i);
+        inner[i] = isChain(instructions[i]) && !defUse.isObserved(i) && users.size() == 1 && instructions[users[0]].opcode == instructions[i].opcode;
+    }
+    std::vector<Instruction> rebuilt;
+    rebuilt.reserve(instructions.size());
+    // new value of each old value
+    std::vector<uint32_t> number(instructions.size());
+    std::vector<uint32_t> leaves;
+    std::vector<uint32_t> stack;
+    for(uint32_t i = 0; i < instructions.size(); i++) {
+        Instruction instruction = instructions[i];
+        if(inner[i]) {
+            // gets rebuilt with its root
+            continue;
+        }
+        if(!isChain(instruction)) {
+            if(instruction.isUnary() || instruction.isBinary()) {
+                instruction.left = number[instruction.left];
+            }
+            if(instruction.isBinary()) {
+                instruction.right = number[instruction.right];
+            }
+            rebuilt.push_back(instruction);
+            number[i] = rebuilt.size() - 1;
+            continue;
+        }
+        // collect the leaves from left to right
+        leaves.clear();
+        stack.assign({instruction.right, instruction.left});
+        while(!stack.empty()) {
+            uint32_t value = stack.back();
+            stack.pop_back();
+            if(inner[value] && instructions[value].opcode == instruction.opcode) {
+                stack.push_back(instructions[value].right);
+                stack.push_back(instructions[value].left);
+            } else {
+                leaves.push_back(number[value]);
+            }
+        }
+        if(leaves.size() == 2) {
+            // already balanced, GVN orders the operands itself
+            rebuilt.push_back(Instruction::binary(instruction.opcode, leaves[0], leaves[1]));
+            number[i] = rebuilt.size() - 1;
+            continue;
+        }
+        rewrites++;
+        // canonical order, so equal chains and common parts of different chains get the same tree and GVN can merge them
+        // constants first and the leaves are paired from the right, so the right end of a chain is shared as deeply as possible
+        std::sort(leaves.begin(), leaves.end(), [&](uint32_t a, uint32_t b) {
+            bool aConstant = rebuilt[a].isConstant();
+            bool bConstant = rebuilt[b].isConstant();
+            return aConstant != bConstant ? aConstant : a < b;
+        });
+        // combine neighbours until one value is left, an odd one at the left end moves up to the next level
+        while(leaves.size() > 1) {
+            size_t odd = leaves.size() % 2;
+            size_t size = odd;
+            for(size_t j = odd; j + 1 < leaves.size(); j += 2) {
+                rebuilt.push_back(Instruction::binary(instruction.opcode, leaves[j], leaves[j + 1]));
+                leaves[size++] = rebuilt.size() - 1;
+            }
+            leaves.resize(size);
+        }
+        number[i] = leaves[0];
+    }
+    for(Definition& definition : program.definitions) {
+        definition.value = number[definition.value];
+    }
+    program.result = number[program.result];
+    program.instructions = std::move(rebuilt);
+}
+
+/// computes the operation on constants
+static int64_t fold(Instruction::Opcode opcode, int64_t left, int64_t right = 0) {
+    return Instruction::unary(opcode, 0).apply(left, right);
+}
+
+/// operands come before their users, so one pass in order folds whole expressions
+/// folded instructions get replaced in place, their operands become unused
+void ConstantPropagation::optimize(Program& program) {
+    std::vector<Instruction>& instructions = program.instructions;
+    for(Instruction& instruction : instructions) {
+        if(instruction.isUnary() && instructions[instruction.left].isConstant()) {
+            instruction = Instruction::constant(instruction.apply(instructions[instruction.left].value, 0));
+            rewrites++;
+        } else if(instruction.isBinary() && instructions[instruction.left].isConstant() && instructions[instruction.right].isConstant()) {
+            // if both operands are constant, combine them to a new constant depending on the operation
+            int64_t left = instructions[instruction.left].value;
+            int64_t right = instructions[instruction.right].value;
+            // the division has to trap when it gets executed, not during compilation
+            if(instruction.opcode == Instruction::Opcode::Divide && Instruction::divisionTraps(left, right)) {
+                continue;
+            }
+            instruction = Instruction::constant(instruction.apply(left, right));
+            rewrites++;
+        }
+    }
+}
+
+/// magic number and shift for the signed division by a divisor >= 3 which is no power of two
+/// quotient = (mulhs(magic, dividend) >> shift) + 1 if the dividend is negative (Hacker's Delight, chapter 10)
+static void computeMagic(uint64_t divisor, int64_t& magic, uint8_t& shift) {
+    constexpr uint64_t two63 = uint64_t(1) << 63;
+    // absolute value of the largest dividend whose remainder is divisor - 1
+    uint64_t anc = two63 - 1 - two63 % divisor;
+    unsigned p = 63;
+    uint64_t q1 = two63 / anc;
+    uint64_t r1 = two63 - q1 * anc;
+    uint64_t q2 = two63 / divisor;
+    uint64_t r2 = two63 - q2 * divisor;
+    uint64_t delta;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if(r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if(r2 >= divisor) {
+            q2++;
+            r2 -= divisor;
+        }
+        delta = divisor - r2;
+    } while(q1 < delta || (q1 == delta && r1 == 0));
+    magic = static_cast<int64_t>(q2 + 1);
+    shift = static_cast<uint8_t>(p - 64);
+}
+
+/// appends instruction, gives back its value
+uint32_t AlgebraicSimplification::emit(Instruction instruction) {
+    mayTrap.push_back(instruction.opcode == Instruction::Opcode::Divide
+        || ((instruction.isUnary() || instruction.isBinary()) && mayTrap[instruction.left])
+        || (instruction.isBinary() && mayTrap[instruction.right]));
+    instructions.push_back(instruction);
+    return static_cast<uint32_t>(instructions.size() - 1);
+}
+
+/// rewrites the instructions into a new array, an instruction can become an existing value or several new ones
+/// operands are simplified before their users, so constants are always the outermost operand of + and * chains
+void AlgebraicSimplification::optimize(Program& program) {
+    instructions.clear();
+    mayTrap.clear();
+    instructions.reserve(program.instructions.size());
+    // new value of each old value
+    std::vector<uint32_t> number(program.instructions.size());
+    for(uint32_t i = 0; i < program.instructions.size(); i++) {
+        Instruction instruction = program.instructions[i];
+        if(instruction.isUnary() || instruction.isBinary()) {
+            instruction.left = number[instruction.left];
+        }
+        if(instruction.isBinary()) {
+            instruction.right = number[instruction.right];
+        }
+        number[i] = simplify(instruction);
+        // anything but a copy of the instruction is a rewrite
+        rewrites += number[i] + 1 != instructions.size() || !(instructions[number[i]] == instruction);
+    }
+    for(Definition& definition : program.definitions) {
+        definition.value = number[definition.value];
+    }
+    program.result = number[program.result];
+    program.instructions.swap(instructions);
+    instructions.clear();
+    mayTrap.clear();
+}
+
+/// appends the simplified form of the instruction, its operands are already rewritten
+uint32_t AlgebraicSimplification::simplify(Instruction instruction) {
+    switch(instruction.opcode) {
+        case Instruction::Opcode::Negate: return simplifyNegate(instruction.left);
+        case Instruction::Opcode::Add: return simplifyAdd(instruction.left, instruction.right);
+        case Instruction::Opcode::Subtract: return simplifySubtract(instruction.left, instruction.right);
+        case Instruction::Opcode::Multiply: return simplifyMultiply(instruction.left, instruction.right);
+        case Instruction::Opcode::Divide: return simplifyDivide(instruction.left, instruction.right);
+        default:
+            if(instruction.isUnary() && instructions[instruction.left].isConstant()) {
+                return emitConstant(instruction.apply(instructions[instruction.left].value, 0));
+            }
+            return emit(instruction);
+    }
+}
+
+uint32_t AlgebraicSimplification::simplifyNegate(uint32_t operand) {
+    Instruction next = instructions[operand];
+    if(next.isConstant()) {
+        return emitConstant(fold(Instruction::Opcode::Negate, next.value));
+    } else if(next.opcode == Instruction::Opcode::Negate) {
+        // -(-x) = x
+        return next.left;
+    }
+    return emit(Instruction::unary(Instruction::Opcode::Negate, operand));
+}
+
+/// constants end up as right operand of the outermost +
+uint32_t AlgebraicSimplification::simplifyAdd(uint32_t left, uint32_t right) {
+    if(instructions[left].isConstant() && !instructions[right].isConstant()) {
+        std::swap(left, right);
+    }
+    Instruction leftInstruction = instructions[left];
+    Instruction rightInstruction = instructions[right];
+    if(rightInstruction.isConstant()) {
+        if(leftInstruction.isConstant()) {
+            return emitConstant(fold(Instruction::Opcode::Add, leftInstruction.value, rightInstruction.value));
+        } else if(rightInstruction.value == 0) {
+            return left;
+        } else if(leftInstruction.opcode == Instruction::Opcode::Add && instructions[leftInstruction.right].isConstant()) {
+            // (x + c1) + c2 = x + (c1 + c2)
+            return simplifyAdd(leftInstruction.left, emitConstant(fold(Instruction::Opcode::Add, instructions[leftInstruction.right].value, rightInstruction.value)));
+        } else if(leftInstruction.opcode == Instruction::Opcode::Subtract && instructions[leftInstruction.left].isConstant()) {
+            // (c1 - x) + c2 = (c1 + c2) - x
+            return simplifySubtract(emitConstant(fold(Instruction::Opcode::Add, instructions[leftInstruction.left].value, rightInstruction.value)), leftInstruction.right);
+        }
+        return emit(Instruction::binary(Instruction::Opcode::Add, left, right));
+    }
+    // move constants of the operands outwards: (x + c) + y = (x + y) + c
+    if(leftInstruction.opcode == Instruction::Opcode::Add && instructions[leftInstruction.right].isConstant()) {
+        return simplifyAdd(simplifyAdd(leftInstruction.left, right), leftInstruction.right);
+    } else if(rightInstruction.opcode == Instruction::Opcode::Add && instructions[rightInstruction.right].isConstant()) {
+        return simplifyAdd(simplifyAdd(left, rightInstruction.left), rightInstruction.right);
+    } else if(leftInstruction.opcode == Instruction::Opcode::Subtract && instructions[leftInstruction.left].isConstant()) {
+        // (c - x) + y = (y - x) + c
+        return simplifyAdd(simplifySubtract(right, leftInstruction.right), leftInstruction.left);
+    } else if(rightInstruction.opcode == Instruction::Opcode::Subtract && instructions[rightInstruction.left].isConstant()) {
+        return simplifyAdd(simplifySubtract(left, rightInstruction.right), rightInstruction.left);
+    } else if(rightInstruction.opcode == Instruction::Opcode::Negate) {
+        // x + (-y) = x - y
+        return simplifySubtract(left, rightInstruction.left);
+    } else if(leftInstruction.opcode == Instruction::Opcode::Negate) {
+        return simplifySubtract(right, leftInstruction.left);
+    }
+    return emit(Instruction::binary(Instruction::Opcode::Add, left, right));
+}
+
+/// subtraction of a constant becomes addition, so it can be combined with the other constants
+uint32_t AlgebraicSimplification::simplifySubtract(uint32_t left, uint32_t right) {
+    Instruction leftInstruction = instructions[left];
+    Instruction rightInstruction = instructions[right];
+    if(leftInstruction.isConstant() && rightInstruction.isConstant()) {
+        return emitConstant(fold(Instruction::Opcode::Subtract, leftInstruction.value, rightInstruction.value));
+    } else if(left == right && !mayTrap[left]) {
+        // x - x = 0
+        return emitConstant(0);
+    } else if(rightInstruction.isConstant()) {
+        // x - c = x + (-c), also correct for INT64_MIN because of the wrap around
+        return simplifyAdd(left, emitConstant(fold(Instruction::Opcode::Negate, rightInstruction.value)));
+    } else if(rightInstruction.opcode == Instruction::Opcode::Negate) {
+        // x - (-y) = x + y
+        return simplifyAdd(left, rightInstruction.left);
+    } else if(leftInstruction.isConstant()) {
+        if(leftInstruction.value == 0) {
+            return simplifyNegate(right);
+        } else if(rightInstruction.opcode == Instruction::Opcode::Add && instructions[rightInstruction.right].isConstant()) {
+            // c1 - (x + c2) = (c1 - c2) - x
+            return simplifySubtract(emitConstant(fold(Instruction::Opcode::Subtract, leftInstruction.value, instructions[rightInstruction.right].value)), rightInstruction.left);
+        } else if(rightInstruction.opcode == Instruction::Opcode::Subtract && instructions[rightInstruction.left].isConstant()) {
+            // c1 - (c2 - x) = x + (c1 - c2)
+            return simplifyAdd(rightInstruction.right, emitConstant(fold(Instruction::Opcode::Subtract, leftInstruction.value, instructions[rightInstruction.left].value)));
+        }
+        return emit(Instruction::binary(Instruction::Opcode::Subtract, left, right));
+    }
+    // move constants of the operands outwards
+    if(leftInstruction.opcode == Instruction::Opcode::Add && instructions[leftInstruction.right].isConstant()) {
+        // (x + c) - y = (x - y) + c
+        return simplifyAdd(simplifySubtract(leftInstruction.left, right), leftInstruction.right);
+    } else if(rightInstruction.opcode == Instruction::Opcode::Add && instructions[rightInstruction.right].isConstant()) {
+        // x - (y + c) = (x - y) + (-c)
+        return simplifyAdd(simplifySubtract(left, rightInstruction.left), emitConstant(fold(Instruction::Opcode::Negate, instructions[rightInstruction.right].value)));
+    }
+    return emit(Instruction::binary(Instruction::Opcode::Subtract, left, right));
+}
+
+/// constants end up as right operand of the outermost *, multiplications by powers of two become shifts
+uint32_t AlgebraicSimplification::simplifyMultiply(uint32_t left, uint32_t right) {
+    if(instructions[left].isConstant() && !instructions[right].isConstant()) {
+        std::swap(left, right);
+    }
+    Instruction leftInstruction = instructions[left];
+    Instruction rightInstruction = instructions[right];
+    if(rightInstruction.isConstant()) {
+        int64_t factor = rightInstruction.value;
+        if(leftInstruction.isConstant()) {
+            return emitConstant(fold(Instruction::Opcode::Multiply, leftInstruction.value, factor));
+        } else if(factor == 0 && !mayTrap[left]) {
+            return emitConstant(0);
+        } else if(factor == 1) {
+            return left;
+        } else if(factor == -1) {
+            return simplifyNegate(left);
+        } else if(leftInstruction.opcode == Instruction::Opcode::Multiply && instructions[leftInstruction.right].isConstant()) {
+            // (x * c1) * c2 = x * (c1 * c2)
+            return simplifyMultiply(leftInstruction.left, emitConstant(fold(Instruction::Opcode::Multiply, instructions[leftInstruction.right].value, factor)));
+        } else if(leftInstruction.opcode == Instruction::Opcode::ShiftLeft) {
+            // (x << k) * c = x * (c << k)
+            return simplifyMultiply(leftInstruction.left, emitConstant(fold(Instruction::Opcode::Multiply, int64_t(1) << leftInstruction.shift, factor)));
+        } else if(leftInstruction.opcode == Instruction::Opcode::Negate) {
+            // (-x) * c = x * (-c)
+            return simplifyMultiply(leftInstruction.left, emitConstant(fold(Instruction::Opcode::Negate, factor)));
+        } else if(factor > 0 && std::has_single_bit(static_cast<uint64_t>(factor))) {
+            return emit(Instruction::unary(Instruction::Opcode::ShiftLeft, left, 0, static_cast<uint8_t>(std::countr_zero(static_cast<uint64_t>(factor)))));
+        }
+        return emit(Instruction::binary(Instruction::Opcode::Multiply, left, right));
+    }
+    // move constants of the operands outwards: (x * c) * y = (x * y) * c
+    if(leftInstruction.opcode == Instruction::Opcode::Multiply && instructions[leftInstruction.right].isConstant()) {
+        return simplifyMultiply(simplifyMultiply(leftInstruction.left, right), leftInstruction.right);
+    } else if(rightInstruction.opcode == Instruction::Opcode::Multiply && instructions[rightInstruction.right].isConstant()) {
+        return simplifyMultiply(simplifyMultiply(left, rightInstruction.left), rightInstruction.right);
+    } else if(leftInstruction.opcode == Instruction::Opcode::ShiftLeft) {
+        return simplifyMultiply(simplifyMultiply(leftInstruction.left, right), emitConstant(int64_t(1) << leftInstruction.shift));
+    } else if(rightInstruction.opcode == Instruction::Opcode::ShiftLeft) {
+        return simplifyMultiply(simplifyMultiply(left, rightInstruction.left), emitConstant(int64_t(1) << rightInstruction.shift));
+    } else if(leftInstruction.opcode == Instruction::Opcode::Negate && rightInstruction.opcode == Instruction::Opcode::Negate) {
+        // (-x) * (-y) = x * y
+        return simplifyMultiply(leftInstruction.left, rightInstruction.left);
+    }
+    return emit(Instruction::binary(Instruction::Opcode::Multiply, left, right));
+}
+
+/// divisions by constants become shifts or multiplications with magic numbers
+/// divisions which could trap keep their Divide, so they still trap when they get executed
+uint32_t AlgebraicSimplification::simplifyDivide(uint32_t left, uint32_t right) {
+    Instruction leftInstruction = instructions[left];
+    Instruction rightInstruction = instructions[right];
+    if(!rightInstruction.isConstant()) {
+        return emit(Instruction::binary(Instruction::Opcode::Divide, left, right));
+    }
+    int64_t divisor = rightInstruction.value;
+    if(divisor == 1) {
+        return left;
+    } else if(leftInstruction.isConstant() && !Instruction::divisionTraps(leftInstruction.value, divisor)) {
+        return emitConstant(leftInstruction.value / divisor);
+    } else if(divisor == 0 || divisor == -1 || divisor == INT64_MIN) {
+        return emit(Instruction::binary(Instruction::Opcode::Divide, left, right));
+    }
+    uint8_t flags = divisor < 0 ? Instruction::negateFlag : 0;
+    uint64_t magnitude = divisor < 0 ? -static_cast<uint64_t>(divisor) : divisor;
+    if(std::has_single_bit(magnitude)) {
+        return emit(Instruction::unary(Instruction::Opcode::DivideByPowerOfTwo, left, 0, static_cast<uint8_t>(std::countr_zero(magnitude)), flags));
+    }
+    int64_t magic;
+    uint8_t shift;
+    computeMagic(magnitude, magic, shift);
+    // the magic number doesn't fit into 63 bits, so its multiplication is missing one dividend
+    if(magic < 0) {
+        flags |= Instruction::addDividendFlag;
+    }
+    return emit(Instruction::unary(Instruction::Opcode::DivideByConstant, left, magic, shift, flags));
+}
+
+} // namespace optimization
+//--------------------------------------------------------------
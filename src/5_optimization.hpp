@@ -0,0 +1,312 @@
+#ifndef H_5_optimization
+#define H_5_optimization
+#include "4_semantic_analysis.hpp"
+#include <chrono>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+//--------------------------------------------------------------
+namespace optimization {
+
+/*
+ * the AST gets lowered to a Program in SSA form, the PassManager runs the optimizations over it
+ * and the evaluation executes the optimized Program
+ */
+
+/// one SSA value, its index in the Program is the value
+/// operands are always defined before, so the instructions can be executed in order
+class Instruction {
+    public:
+    /// possible operations, operations with one operand come before the binary ones
+    enum class Opcode : uint8_t {
+        Constant,
+        /// reads the argument of a parameter from the frame
+        Parameter,
+        Negate,
+        /// left << shift
+        ShiftLeft,
+        /// signed division by 2^shift, rounding towards zero
+        DivideByPowerOfTwo,
+        /// signed division by a constant through multiplication with the magic number in value
+        DivideByConstant,
+        Add,
+        Subtract,
+        Multiply,
+        Divide
+    };
+    /// flags of the divisions by constants
+    static constexpr uint8_t negateFlag = 1;
+    static constexpr uint8_t addDividendFlag = 2;
+    Opcode opcode;
+    /// immediates of the operations with one operand, they fit into the padding
+    uint8_t shift = 0;
+    uint8_t flags = 0;
+    /// left operand, the operand of operations with one operand, or slot of the parameter
+    uint32_t left;
+    union {
+        /// right operand of binary operations
+        uint32_t right;
+        /// value of constants, magic number of DivideByConstant
+        int64_t value;
+    };
+    /// create instructions
+    static Instruction constant(int64_t value) { Instruction instruction; instruction.opcode = Opcode::Constant; instruction.left = 0; instruction.value = value; return instruction; }
+    static Instruction parameter(uint32_t slot) { Instruction instruction; instruction.opcode = Opcode::Parameter; instruction.left = slot; instruction.value = 0; return instruction; }
+    static Instruction unary(Opcode opcode, uint32_t operand, int64_t value = 0, uint8_t shift = 0, uint8_t flags = 0) { Instruction instruction; instruction.opcode = opcode; instruction.shift = shift; instruction.flags = flags; instruction.left = operand; instruction.value = value; return instruction; }
+    static Instruction binary(Opcode opcode, uint32_t left, uint32_t right) { Instruction instruction; instruction.opcode = opcode; instruction.left = left; instruction.value = 0; instruction.right = right; return instruction; }
+    /// kind of instruction
+    bool isConstant() const { return opcode == Opcode::Constant; }
+    bool isUnary() const { return opcode >= Opcode::Negate && opcode < Opcode::Add; }
+    bool isBinary() const { return opcode >= Opcode::Add; }
+    /// comparison operator
+    bool operator==(const Instruction& other) const {
+        return opcode == other.opcode && shift == other.shift && flags == other.flags && left == other.left && (isBinary() ? right == other.right : value == other.value);
+    }
+    /// computes an operation from the values of its operands, right is ignored by operations with one operand
+    /// +, - and * wrap around like two's complement, division traps on zero like the hardware
+    int64_t apply(int64_t left, int64_t right) const;
+    /// true if the hardware traps on the division
+    static bool divisionTraps(int64_t left, int64_t right) { return right == 0 || (left == INT64_MIN && right == -1); }
+};
+static_assert(sizeof(Instruction) == 16, "Instruction should stay 16 bytes");
+
+/// computes an operation from the values of its operands
+inline int64_t Instruction::apply(int64_t left, int64_t right) const {
+    switch(opcode) {
+        case Opcode::Negate:
+            return static_cast<int64_t>(0 - static_cast<uint64_t>(left));
+        case Opcode::ShiftLeft:
+            return static_cast<int64_t>(static_cast<uint64_t>(left) << shift);
+        case Opcode::DivideByPowerOfTwo: {
+            // negative dividends get 2^shift - 1 added, so the shift rounds towards zero
+            int64_t bias = static_cast<int64_t>(static_cast<uint64_t>(left >> 63) >> (64 - shift));
+            int64_t quotient = (left + bias) >> shift;
+            return (flags & negateFlag) ? -quotient : quotient;
+        }
+        case Opcode::DivideByConstant: {
+            int64_t quotient = static_cast<int64_t>((static_cast<__int128>(value) * left) >> 64);
+            if(flags & addDividendFlag) {
+                quotient += left;
+            }
+            quotient >>= shift;
+            // round towards zero for negative dividends
+            quotient += static_cast<int64_t>(static_cast<uint64_t>(left) >> 63);
+            return (flags & negateFlag) ? -quotient : quotient;
+        }
+        case Opcode::Add:
+            return static_cast<int64_t>(static_cast<uint64_t>(left) + static_cast<uint64_t>(right));
+        case Opcode::Subtract:
+            return static_cast<int64_t>(static_cast<uint64_t>(left) - static_cast<uint64_t>(right));
+        case Opcode::Multiply:
+            return static_cast<int64_t>(static_cast<uint64_t>(left) * static_cast<uint64_t>(right));
+        case Opcode::Divide:
+            return left / right;
+        default:
+            // constants and parameters have no operands
+            return value;
+    }
+}
+
+/// new version of a slot, created by an assignment
+class Definition {
+    public:
+    /// id of the assigned identifier
+    uint32_t slot;
+    /// value of this version
+    uint32_t value;
+    /// comparison operator
+    bool operator==(const Definition& other) const = default;
+};
+
+/// function in SSA form, the statements are straight-line code, so there are no phi nodes
+/// every assignment defines a new version of its slot, reads refer directly to the value of the current version
+/// so constants and copies assigned to variables are propagated to all later reads while lowering
+class Program {
+    public:
+    std::vector<Instruction> instructions;
+    /// versions of the slots in order of the assignments, the last one of each slot is its final value
+    std::vector<Definition> definitions;
+    /// value given back by RETURN
+    uint32_t result = 0;
+    /// default constructor
+    Program() = default;
+    /// lowers the AST, reads of unassigned variables get the initial value of the identifier
+    Program(const semantic_analysis::Function& function, std::span<const semantic_analysis::Identifier> identifiers);
+    /// appends instruction, gives back its value
+    uint32_t addInstruction(Instruction instruction);
+    /// removes instructions which are neither used by other instructions, definitions nor the result
+    /// divisions which could trap are never removed, the remaining values get renumbered
+    void removeUnused();
+    /// moves the slots to new positions in the frame, newSlot is indexed by the old slot
+    void renumberSlots(std::span<const uint32_t> newSlot);
+    /// replaces the reads of the parameter with a constant
+    void bindParameter(uint32_t slot, int64_t value);
+    /// appends the instructions of the other program, its parameter in slot s reads newSlot[s]
+    /// gives back the value of its result, its definitions are not taken over
+    uint32_t append(const Program& other, std::span<const uint32_t> newSlot);
+    /// comparison operator
+    bool operator==(const Program& other) const = default;
+    /// prints one instruction per line, names of the slots come from the identifiers
+    void print(std::ostream& out, std::span<const semantic_analysis::Identifier> identifiers) const;
+};
+
+/// users of each value, computed once from the operands
+class DefUse {
+    private:
+    /// users of value v are users[begins[v], begins[v + 1])
+    std::vector<uint32_t> begins;
+    std::vector<uint32_t> users;
+    /// values which are used by a definition or the result
+    std::vector<bool> observed;
+    public:
+    /// constructor
+    explicit DefUse(const Program& program);
+    /// instructions which use the value as operand, in order
+    std::span<const uint32_t> getUsers(uint32_t value) const;
+    /// true if any instruction, definition or the result uses the value
+    bool isUsed(uint32_t value) const;
+    /// true if a definition or the result uses the value
+    bool isObserved(uint32_t value) const { return observed[value]; }
+};
+
+/// optimization pass over the Program
+class Optimization {
+    protected:
+    /// instructions or definitions the pass rewrote, folded or removed since the last takeRewrites
+    size_t rewrites = 0;
+    public:
+    virtual ~Optimization() = default;
+    /// name of the pass
+    virtual std::string_view getName() const = 0;
+    virtual void optimize(Program& program) = 0;
+    /// gives back the rewrites and resets them
+    size_t takeRewrites() { return std::exchange(rewrites, 0); }
+};
+
+/// statistics of one pass in one round of the pipeline
+class PassStatistics {
+    public:
+    /// name of the pass
+    std::string_view name;
+    /// round of the pipeline, passes added with addFinalPass get the round after the last one
+    unsigned round = 0;
+    /// position of the pass in the pipeline, a pass can be added more than once
+    unsigned position = 0;
+    /// how often the pass ran, more than once if reports of several programs are merged
+    size_t runs = 0;
+    /// wall time of the pass including the removal of the values it made unused
+    std::chrono::nanoseconds time{0};
+    size_t instructionsBefore = 0;
+    size_t instructionsAfter = 0;
+    size_t rewrites = 0;
+    /// program after the pass, only filled if CompileReport::dumpPrograms is set
+    std::string dump;
+};
+
+/// statistics of the passes which the PassManager ran, in the order they ran
+class CompileReport {
+    public:
+    /// print the program after each pass, costs much more time than the passes themselves
+    bool dumpPrograms = false;
+    /// number of programs the pipeline ran over
+    size_t programs = 0;
+    std::vector<PassStatistics> passes;
+    /// sums up the statistics of passes with the same position and round, dumps are not merged
+    void merge(const CompileReport& other);
+    /// prints one line per pass and round, followed by its dump
+    void print(std::ostream& out) const;
+};
+
+/// runs the passes in the order they were added, unused instructions get removed after each pass
+/// the whole pipeline is repeated while it still changes the program, at most maxRounds times
+class PassManager {
+    private:
+    std::vector<std::unique_ptr<Optimization>> passes;
+    /// run once after the rounds, for passes which would work against the others
+    std::vector<std::unique_ptr<Optimization>> finalPasses;
+    unsigned maxRounds;
+    public:
+    /// constructor
+    explicit PassManager(unsigned maxRounds = 1) : maxRounds(maxRounds) {}
+    /// appends pass to the pipeline
+    void addPass(std::unique_ptr<Optimization> pass);
+    /// appends pass which runs once after the pipeline reached its fixpoint
+    void addFinalPass(std::unique_ptr<Optimization> pass);
+    /// runs the pipeline, statistics of each pass are appended to the report if there is one
+    /// dumps need the identifiers to print the names of the slots
+    void run(Program& program, CompileReport* report = nullptr, std::span<const semantic_analysis::Identifier> identifiers = {});
+    /// pipeline used for compilation, the final values of the observed slots are kept
+    static PassManager createDefault(std::vector<uint32_t> observedSlots = {});
+};
+
+/// removes dead stores: reads already refer to the SSA values, so a definition is only needed if its slot is observed after the evaluation
+/// only the last definition of each observed slot is kept, computations used by nothing else become unused
+/// divisions which could trap stay in the program though, a dead store of a / 0 still traps like (a / 0) * 0
+/// code after "." is already ignored by the parser
+class DeadCodeElimination : public Optimization {
+    private:
+    /// slots whose final value is read after the evaluation
+    std::vector<uint32_t> observedSlots;
+    public:
+    /// constructor, by default only the result is observed
+    explicit DeadCodeElimination(std::vector<uint32_t> observedSlots = {}) : observedSlots(std::move(observedSlots)) {}
+    std::string_view getName() const override { return "DeadCodeElimination"; }
+    void optimize(Program& program) override;
+};
+
+/// common subexpression elimination: identical instructions over the same values get one value number
+/// a redefinition of a slot is a new value, so expressions over different versions stay apart
+class GlobalValueNumbering : public Optimization {
+    public:
+    std::string_view getName() const override { return "GlobalValueNumbering"; }
+    void optimize(Program& program) override;
+};
+
+/// rewrites instructions with identities (x+0, x*1, x*0, -(-x), x-x, ...), reassociates constants of + and * chains
+/// and replaces multiplications and divisions by constants with shifts and magic-number multiplications
+/// divisions which could trap (by 0, -1 or INT64_MIN) are kept as they are, identities never drop an operand which could trap
+class AlgebraicSimplification : public Optimization {
+    private:
+    /// rewritten instructions
+    std::vector<Instruction> instructions;
+    /// for each rewritten instruction, true if a Divide is among its operands, so x*0 and x-x must keep computing x
+    std::vector<bool> mayTrap;
+    uint32_t emit(Instruction instruction);
+    uint32_t emitConstant(int64_t value) { return emit(Instruction::constant(value)); }
+    /// appends the simplified form of the instruction, gives back its value
+    uint32_t simplify(Instruction instruction);
+    uint32_t simplifyAdd(uint32_t left, uint32_t right);
+    uint32_t simplifySubtract(uint32_t left, uint32_t right);
+    uint32_t simplifyMultiply(uint32_t left, uint32_t right);
+    uint32_t simplifyDivide(uint32_t left, uint32_t right);
+    uint32_t simplifyNegate(uint32_t operand);
+    public:
+    std::string_view getName() const override { return "AlgebraicSimplification"; }
+    void optimize(Program& program) override;
+};
+
+/// rebalances chains of + and * into trees of minimal height, so the operations of the chain don't depend on each other
+/// the parser builds right-leaning chains, so a*b*c*d is a*(b*(c*d)) with three dependent multiplications
+/// both operations wrap around, so they are associative and commutative, - and / are not touched
+/// the leaves get a canonical order, so parts which chains have in common become the same subtrees
+/// AlgebraicSimplification moves constants back outwards, so this pass has to run after it
+class TreeHeightReduction : public Optimization {
+    public:
+    std::string_view getName() const override { return "TreeHeightReduction"; }
+    void optimize(Program& program) override;
+};
+
+/// folds instructions whose operands are all constant, divisions which would trap are kept
+class ConstantPropagation : public Optimization {
+    public:
+    std::string_view getName() const override { return "ConstantPropagation"; }
+    void optimize(Program& program) override;
+};
+
+} // namespace optimization
+//--------------------------------------------------------------
+#endif
@@ -1,24 +1,300 @@
 #include "6_lib_interface.hpp"
+#include <algorithm>
+#include <unordered_map>
 //-------------------------------------------------------------------------------------------------
 namespace interface {
 
+/// compiles the function and frees the source code if it is valid
+Function::Function(std::vector<std::string_view> sourceCode, code_management::NamePool* namePool, optimization::CompileReport* report, std::span<const std::string_view> outputs)
+    : sourceCode(std::move(sourceCode)), evaluation(compile(this->sourceCode, diagnostics, namePool, report, outputs)) {
+    if(isValid()) {
+        this->sourceCode.clear();
+        this->sourceCode.shrink_to_fit();
+    }
+}
+
+/// compiles the code, the CodeManager is only needed during compilation
+execution::Evaluation Function::compile(std::span<const std::string_view> sourceCode, code_management::Diagnostics& diagnostics, code_management::NamePool* namePool, optimization::CompileReport* report, std::span<const std::string_view> outputs) {
+    code_management::CodeManager codeManager(sourceCode);
+    return execution::Evaluation(codeManager, diagnostics, namePool, report, outputs);
+}
+
+/// prints compile errors with context of the code
+void Function::printDiagnostics(std::ostream& out) const {
+    code_management::CodeManager codeManager(sourceCode);
+    diagnostics.render(codeManager, out);
+}
+
+/// bytes used by the function, including the object itself
+size_t Function::getMemoryUsage() const {
+    return sizeof(Function)
+        + sourceCode.capacity() * sizeof(std::string_view)
+        + diagnostics.getDiagnostics().size() * sizeof(code_management::Diagnostic)
+        + evaluation.getMemoryUsage()
+        + (speculation ? sizeof(execution::Speculation) + speculation->getMemoryUsage() : 0)
+        + (cache ? sizeof(ResultCache) + cache->getMemoryUsage() : 0);
+}
+
+/// the specialized function is compiled from the optimized program, not from the source code
+Function Function::specialize(std::initializer_list<std::pair<std::string_view, int64_t>> bindings) const {
+    code_management::Diagnostics specializationDiagnostics;
+    execution::Evaluation specialized = evaluation.specialize(std::span(bindings.begin(), bindings.size()), specializationDiagnostics);
+    return {std::move(specializationDiagnostics), std::move(specialized)};
+}
+
 int64_t Function::operator()(std::initializer_list<int64_t> list) {
-    return evaluation.evaluateFunction(list);
+    if(evaluation.isConstant()) {
+        // neither profiling nor memoization pay off
+        return evaluation.getConstant();
+    }
+    std::span<const int64_t> arguments(list.begin(), list.size());
+    if(cache) {
+        if(std::optional<int64_t> result = cache->lookup(arguments)) {
+            return *result;
+        }
+    }
+    int64_t result = choose(arguments).evaluateFunction(arguments);
+    if(cache) {
+        cache->insert(arguments, result);
+    }
+    return result;
 }
 
+/// the arity is the number of parameters, they come first in the frame
+void Function::enableResultCache(size_t capacity) {
+    size_t arity = getParameterNames().size();
+    cache = std::make_unique<ResultCache>(arity, capacity);
+}
 
-/// TODO: wont work because function is stored as local variable and not in member variable
-Handle Pljit::registerFunction(std::string_view code) {
-    std::vector<std::string_view> sourceCode = parseLines(code);
-    Function function(sourceCode);
-    return {&function};
+/// the shared work of the outputs is computed once
+void Function::evaluate(std::span<const int64_t> arguments, std::span<int64_t> outputs) {
+    choose(arguments).evaluateFunction(arguments, outputs);
+}
+
+/// the profiles are only created by the first call with speculation enabled
+execution::Evaluation& Function::choose(std::span<const int64_t> arguments) {
+    if(!speculationEnabled) {
+        return evaluation;
+    }
+    if(!speculation) {
+        speculation = std::make_unique<execution::Speculation>();
+    }
+    return speculation->choose(evaluation, arguments);
+}
+
+
+/// gives back names of the parameters in order
+std::vector<std::string_view> Function::getParameterNames() const {
+    std::vector<std::string_view> names;
+    for(const semantic_analysis::Identifier& identifier : evaluation.getIdentifiers()) {
+        // parameters come first
+        if(identifier.type != semantic_analysis::Identifier::Type::Parameter) {
+            break;
+        }
+        names.push_back(identifier.name);
+    }
+    return names;
+}
+
+/// compiles the code, only merging its statistics is synchronized
+std::unique_ptr<Function> Pljit::compile(std::string_view code, std::span<const std::string_view> outputs) {
+    if(!compileReportEnabled) {
+        return std::make_unique<Function>(parseLines(code), &namePool, nullptr, outputs);
+    }
+    optimization::CompileReport report;
+    auto function = std::make_unique<Function>(parseLines(code), &namePool, &report, outputs);
+    std::lock_guard lock(mutex);
+    compileReport.merge(report);
+    return function;
+}
+
+/// gives back the summed up statistics of the passes
+optimization::CompileReport Pljit::getCompileReport() const {
+    std::lock_guard lock(mutex);
+    return compileReport;
+}
+
+/// the optimized programs are appended behind each other and their results become definitions, one slot per function
+/// the pipeline runs again over the whole program, so GVN merges the subexpressions the functions share
+FusedFunction Pljit::fuse(std::span<const Handle> handles) const {
+    std::vector<std::string_view> parameterNames;
+    // column of each name id of the NamePool
+    std::unordered_map<unsigned, uint32_t> columnOf;
+    optimization::Program program;
+    std::vector<uint32_t> results;
+    for(const Handle& handle : handles) {
+        const execution::Evaluation& evaluation = handle.getFunction().getEvaluation();
+        if(!evaluation.program) {
+            code_management::Diagnostics diagnostics;
+            diagnostics.report("error: function with compile errors can't be fused!");
+            return FusedFunction(std::move(diagnostics));
+        }
+        std::vector<uint32_t> newSlot(evaluation.getIdentifiers().size(), 0);
+        for(const semantic_analysis::Identifier& identifier : evaluation.getIdentifiers()) {
+            if(identifier.type != semantic_analysis::Identifier::Type::Parameter) {
+                break;
+            }
+            auto [it, inserted] = columnOf.try_emplace(identifier.nameId, static_cast<uint32_t>(parameterNames.size()));
+            if(inserted) {
+                parameterNames.push_back(identifier.name);
+            }
+            newSlot[identifier.id] = it->second;
+        }
+        results.push_back(program.append(*evaluation.program, newSlot));
+    }
+    // the slots of the results come after the columns, so they can't be mistaken for parameters
+    std::vector<uint32_t> resultSlots;
+    for(uint32_t i = 0; i < results.size(); i++) {
+        resultSlots.push_back(static_cast<uint32_t>(parameterNames.size()) + i);
+        program.definitions.push_back({resultSlots.back(), results[i]});
+    }
+    program.result = results.empty() ? program.addInstruction(optimization::Instruction::constant(0)) : results[0];
+    optimization::PassManager::createDefault(resultSlots).run(program);
+    // the definitions follow the results through the passes
+    for(const optimization::Definition& definition : program.definitions) {
+        results[definition.slot - parameterNames.size()] = definition.value;
+    }
+    program.definitions.clear();
+    return {std::move(parameterNames), execution::VectorizedEvaluation(std::move(program), std::move(results))};
+}
+
+/// compiles the function without holding the lock, only storing it is synchronized
+Handle Pljit::registerFunction(std::string_view code, std::span<const std::string_view> outputs) {
+    std::unique_ptr<Function> function = compile(code, outputs);
+    Function* result = function.get();
+    std::lock_guard lock(mutex);
+    functions.push_back(std::move(function));
+    return {result};
+}
+
+/// number of functions registered with registerFunction
+size_t Pljit::getFunctionCount() const {
+    std::lock_guard lock(mutex);
+    return functions.size();
 }
 
-Function Pljit::registerFunctionAlternative(std::string_view code) {
+/// bytes used by all functions registered with registerFunction
+size_t Pljit::getMemoryUsage() const {
+    std::lock_guard lock(mutex);
+    size_t bytes = functions.capacity() * sizeof(std::unique_ptr<Function>);
+    for(const std::unique_ptr<Function>& function : functions) {
+        bytes += function->getMemoryUsage();
+    }
+    return bytes;
+}
+
+Function Pljit::registerFunctionAlternative(std::string_view code, std::span<const std::string_view> outputs) {
     std::vector<std::string_view> sourceCode = parseLines(code);
-    return {sourceCode};
+    if(!compileReportEnabled) {
+        return {sourceCode, &namePool, nullptr, outputs};
+    }
+    optimization::CompileReport report;
+    Function function(sourceCode, &namePool, &report, outputs);
+    std::lock_guard lock(mutex);
+    compileReport.merge(report);
+    return function;
 }
 
+//-------------------------------------------------------------------------------------------------
+// Begin: result cache
+
+/// constructor, the capacity gets rounded up to a multiple of shardCount * ways entries
+ResultCache::ResultCache(size_t arity, size_t capacity) : arity(arity), sets(std::max<size_t>(1, (capacity + shardCount * ways - 1) / (shardCount * ways))) {
+    for(Shard& shard : shards) {
+        shard.arguments.resize(sets * ways * arity);
+        shard.results.resize(sets * ways);
+        shard.states.resize(sets * ways, empty);
+        shard.hands.resize(sets, 0);
+    }
+}
+
+/// mixes each argument like splitmix64, so tuples which differ in one argument spread over all shards
+uint64_t ResultCache::hash(std::span<const int64_t> arguments) const {
+    uint64_t hash = arity;
+    for(size_t i = 0; i < arity; i++) {
+        uint64_t x = hash + (i < arguments.size() ? static_cast<uint64_t>(arguments[i]) : 0) + 0x9e3779b97f4a7c15;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        hash = x ^ (x >> 31);
+    }
+    return hash;
+}
+
+/// true if the entry holds the arguments
+bool ResultCache::matches(const Shard& shard, size_t entry, std::span<const int64_t> arguments) const {
+    const int64_t* saved = &shard.arguments[entry * arity];
+    for(size_t i = 0; i < arity; i++) {
+        if(saved[i] != (i < arguments.size() ? arguments[i] : 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// the lower bits of the hash select the shard, the upper bits the set
+std::optional<int64_t> ResultCache::lookup(std::span<const int64_t> arguments) {
+    uint64_t h = hash(arguments);
+    Shard& shard = shards[h & (shardCount - 1)];
+    size_t set = (h >> shardBits) % sets;
+    std::lock_guard lock(shard.mutex);
+    for(size_t entry = set * ways; entry < (set + 1) * ways; entry++) {
+        if(shard.states[entry] != empty && matches(shard, entry, arguments)) {
+            shard.states[entry] = valid | referenced;
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return shard.results[entry];
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+/// empty entries are taken first, else the hand clears referenced bits until it finds an entry without one
+void ResultCache::insert(std::span<const int64_t> arguments, int64_t result) {
+    uint64_t h = hash(arguments);
+    Shard& shard = shards[h & (shardCount - 1)];
+    size_t set = (h >> shardBits) % sets;
+    std::lock_guard lock(shard.mutex);
+    size_t target = set * ways;
+    bool found = false;
+    for(size_t entry = set * ways; entry < (set + 1) * ways; entry++) {
+        // another thread might have inserted it in the meantime
+        if(shard.states[entry] == empty || matches(shard, entry, arguments)) {
+            target = entry;
+            found = true;
+            break;
+        }
+    }
+    if(!found) {
+        uint8_t& hand = shard.hands[set];
+        while(shard.states[set * ways + hand] & referenced) {
+            shard.states[set * ways + hand] = valid;
+            hand = (hand + 1) % ways;
+        }
+        target = set * ways + hand;
+        hand = (hand + 1) % ways;
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    for(size_t i = 0; i < arity; i++) {
+        shard.arguments[target * arity + i] = i < arguments.size() ? arguments[i] : 0;
+    }
+    shard.results[target] = result;
+    shard.states[target] = valid;
+}
+
+/// bytes on the heap owned by the cache
+size_t ResultCache::getMemoryUsage() const {
+    size_t bytes = 0;
+    for(const Shard& shard : shards) {
+        bytes += shard.arguments.capacity() * sizeof(int64_t)
+            + shard.results.capacity() * sizeof(int64_t)
+            + shard.states.capacity() + shard.hands.capacity();
+    }
+    return bytes;
+}
+
+// End: result cache
+//-------------------------------------------------------------------------------------------------
+
 /// parse code into vector of string_view where each element is one line
 std::vector<std::string_view> parseLines(std::string_view code) {
     std::vector<std::string_view> vector;
@@ -2,6 +2,12 @@
 #define H_6_library_interface
 #include <string_view>
 #include <span>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 #include "1_code_management.hpp"
 #include "5_execution.hpp"
 //-------------------------------------------------------------------------------------------------
@@ -14,20 +20,135 @@ namespace interface {
 /// splits string by newlines
 std::vector<std::string_view> parseLines(std::string_view code);
 
+/// bounded memoization of results by their argument tuples, functions are pure over their parameters
+/// entries are spread over shards with their own locks, each shard is a set-associative table which allocates nothing after construction
+/// a full set evicts with second chance: entries hit since the last eviction survive one more round
+/// thread safe on its own, a function using it is not (see Function)
+class ResultCache {
+    public:
+    /// counters, updated without locks
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+    static constexpr unsigned shardBits = 4;
+    static constexpr unsigned shardCount = 1u << shardBits;
+    /// entries per set
+    static constexpr unsigned ways = 4;
+    private:
+    /// part of the cache with its own lock, selected by the lower bits of the hash
+    struct Shard {
+        std::mutex mutex;
+        /// arguments of the entries, arity values per entry
+        std::vector<int64_t> arguments;
+        std::vector<int64_t> results;
+        /// empty, valid, or valid and hit since the last eviction in its set
+        std::vector<uint8_t> states;
+        /// next way to check for eviction in each set
+        std::vector<uint8_t> hands;
+    };
+    static constexpr uint8_t empty = 0;
+    static constexpr uint8_t valid = 1;
+    static constexpr uint8_t referenced = 2;
+    /// number of arguments of the function, missing ones are 0
+    size_t arity;
+    size_t sets;
+    std::array<Shard, shardCount> shards;
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> evictions = 0;
+    /// hash of the arguments, padded with 0 to the arity
+    uint64_t hash(std::span<const int64_t> arguments) const;
+    /// true if the entry holds the arguments
+    bool matches(const Shard& shard, size_t entry, std::span<const int64_t> arguments) const;
+    public:
+    /// constructor, the capacity gets rounded up to a multiple of shardCount * ways entries
+    ResultCache(size_t arity, size_t capacity);
+    /// gives back the cached result of the arguments, nullopt on a miss
+    std::optional<int64_t> lookup(std::span<const int64_t> arguments);
+    /// saves the result of the arguments, evicting an entry of its set if it is full
+    void insert(std::span<const int64_t> arguments, int64_t result);
+    /// number of entries which fit into the cache
+    size_t getCapacity() const { return shardCount * sets * ways; }
+    Statistics getStatistics() const { return {hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed), evictions.load(std::memory_order_relaxed)}; }
+    /// bytes on the heap owned by the cache
+    size_t getMemoryUsage() const;
+};
+
 /// saves function
+/// after compilation only the executable form is kept, the source code only if there are errors to print
+/// calls reuse the buffers of the evaluation and update the profiles, so a function must not be called from several threads at once
 class Function {
     private:
+    /// compile errors
+    code_management::Diagnostics diagnostics;
+    /// lines of the source code, cleared after successful compilation
     std::vector<std::string_view> sourceCode;
-    code_management::CodeManager codeManager;
     execution::Evaluation evaluation;
+    /// value profiles and the specialized version, created by the first call
+    std::unique_ptr<execution::Speculation> speculation;
+    /// false if calls always run the generic version without profiling
+    bool speculationEnabled = true;
+    /// nullptr while memoization is disabled
+    std::unique_ptr<ResultCache> cache;
+    /// compiles the code, the CodeManager is only needed during compilation
+    static execution::Evaluation compile(std::span<const std::string_view> sourceCode, code_management::Diagnostics& diagnostics, code_management::NamePool* namePool, optimization::CompileReport* report, std::span<const std::string_view> outputs);
+    /// constructor for functions derived from compiled ones, there is no source code
+    Function(code_management::Diagnostics diagnostics, execution::Evaluation evaluation) : diagnostics(std::move(diagnostics)), evaluation(std::move(evaluation)) {}
+    /// gives back the version to call with the arguments, profiling them if speculation is enabled
+    execution::Evaluation& choose(std::span<const int64_t> arguments);
     public:
-    /// constructor
-    Function(std::vector<std::string_view> sourceCode) : sourceCode(sourceCode), codeManager(sourceCode), evaluation(codeManager) {}
+    /// constructor, names get interned into the NamePool if there is one
+    /// statistics of the optimization passes go into the report if there is one, it is not kept by the function
+    /// the variables named in outputs can be given back by evaluate besides the result
+    Function(std::vector<std::string_view> sourceCode, code_management::NamePool* namePool = nullptr, optimization::CompileReport* report = nullptr, std::span<const std::string_view> outputs = {});
+    /// false if the code has compile errors, it can't be called then
+    bool isValid() const { return evaluation.program.has_value(); }
+    /// true if the function was folded to a constant at registration, calls only load it
+    bool isConstant() const { return evaluation.isConstant(); }
+    /// gives back compile errors
+    const code_management::Diagnostics& getDiagnostics() const { return diagnostics; }
+    /// prints compile errors with context of the code, the code has to be still alive
+    void printDiagnostics(std::ostream& out) const;
+    /// gives back names of the parameters in order, they don't depend on the source code if there is a NamePool
+    std::vector<std::string_view> getParameterNames() const;
+    /// bytes used by the function, including the object itself
+    size_t getMemoryUsage() const;
+    /// gives back a new function with the named parameters fixed to values, it takes the other parameters in the same order
+    /// e.g. specialize({{"depth", 3}}), an unknown name gives back an invalid function with a diagnostic
+    /// parameters are found by name, so the function needs a NamePool
+    Function specialize(std::initializer_list<std::pair<std::string_view, int64_t>> bindings) const;
+    /// gives back the version specialized on nearly constant arguments, nullptr if there is none (yet)
+    const execution::Evaluation* getSpeculation() const { return speculation ? speculation->getSpecialized() : nullptr; }
+    /// calls the function, arguments get profiled and nearly constant ones get specialized automatically
+    /// results come from the cache if memoization is enabled
     int64_t operator()(std::initializer_list<int64_t> list);
+    /// memoizes the results of up to capacity argument tuples, an existing cache gets dropped
+    void enableResultCache(size_t capacity);
+    void disableResultCache() { cache.reset(); }
+    /// counters of the cache, all 0 if memoization is disabled
+    ResultCache::Statistics getCacheStatistics() const { return cache ? cache->getStatistics() : ResultCache::Statistics(); }
+    /// stops profiling the arguments and drops the specialized version, calls only run the generic version
+    void disableSpeculation() { speculationEnabled = false; speculation.reset(); }
+    /// profiles the calls from now on, speculation is enabled by default
+    void enableSpeculation() { speculationEnabled = true; }
+    /// calls the function once and fills outputs with the final values of the selected variables, followed by the result
+    void evaluate(std::span<const int64_t> arguments, std::span<int64_t> outputs);
+    /// size of the outputs of evaluate
+    size_t getOutputCount() const { return evaluation.getOutputCount(); }
+    /// context which keeps the values of one evaluation and only recomputes what depends on changed parameters
+    /// the function has to be valid and outlive it
+    execution::IncrementalEvaluation createIncrementalEvaluation(std::span<const int64_t> arguments) const { return {evaluation, arguments}; }
+    /// interpreter which evaluates batches of rows vector by vector, the function has to be valid
+    execution::VectorizedEvaluation createVectorizedEvaluation() const { return execution::VectorizedEvaluation(evaluation); }
+    /// compiled form of the function
+    const execution::Evaluation& getEvaluation() const { return evaluation; }
     int64_t operator()() {return operator()({});};
 };
 
 /// lightweight handle
+/// calls through handles of the same function must not overlap, see Function
 class Handle {
     private:
     Function* function;
@@ -35,6 +156,14 @@ class Handle {
     /// constructor
     Handle(Function* function) : function(function) {}
     int64_t operator()(std::initializer_list<int64_t> list) {return (*function)(list);}
+    /// the function the handle points to
+    const Function& getFunction() const { return *function; }
+    /// memoization of the function, see Function
+    void enableResultCache(size_t capacity) { function->enableResultCache(capacity); }
+    void disableResultCache() { function->disableResultCache(); }
+    ResultCache::Statistics getCacheStatistics() const { return function->getCacheStatistics(); }
+    /// speculation of the function, see Function
+    void disableSpeculation() { function->disableSpeculation(); }
     /// copy constructor
     Handle(const Handle&) = default;
     /// copy assignment
@@ -42,16 +171,72 @@ class Handle {
 
 };
 
+/// several functions fused into one program which computes all their results in one pass over the input columns
+/// parameters with the same name share one column, subexpressions which are the same in several functions are computed once
+class FusedFunction {
+    private:
+    /// errors of the fusion
+    code_management::Diagnostics diagnostics;
+    /// names of the columns in order
+    std::vector<std::string_view> parameterNames;
+    /// nullopt if a function couldn't be fused
+    std::optional<execution::VectorizedEvaluation> evaluation;
+    public:
+    /// constructor
+    FusedFunction(std::vector<std::string_view> parameterNames, execution::VectorizedEvaluation evaluation) : parameterNames(std::move(parameterNames)), evaluation(std::move(evaluation)) {}
+    /// constructor of an invalid fusion
+    explicit FusedFunction(code_management::Diagnostics diagnostics) : diagnostics(std::move(diagnostics)) {}
+    /// false if a function couldn't be fused, it can't be evaluated then
+    bool isValid() const { return evaluation.has_value(); }
+    /// gives back errors of the fusion
+    const code_management::Diagnostics& getDiagnostics() const { return diagnostics; }
+    /// names of the parameters of all functions, one column per name in this order
+    const std::vector<std::string_view>& getParameterNames() const { return parameterNames; }
+    /// number of instructions of the fused program
+    size_t getInstructionCount() const { return evaluation->getProgram().instructions.size(); }
+    /// the fused program
+    const optimization::Program& getProgram() const { return evaluation->getProgram(); }
+    /// outputs[f][r] is the result of function f for row r, the argument of parameter p in row r is columns[p][r]
+    /// gives back the number of rows evaluated, it stops at the first row with a division which would trap
+    size_t evaluate(std::span<const std::span<const int64_t>> columns, std::span<const std::span<int64_t>> outputs) { return evaluation->evaluate(columns, outputs); }
+};
+
 /// creates new functions
+/// registering is thread safe, calling the functions is not
 class Pljit {
     private:
-    std::vector<Function> list;
+    /// names of all functions
+    code_management::NamePool namePool;
+    /// guards functions
+    mutable std::mutex mutex;
+    /// registered functions, Handles point to them
+    std::vector<std::unique_ptr<Function>> functions;
+    /// statistics of the passes over all functions compiled while the report is enabled, guarded by mutex
+    std::atomic<bool> compileReportEnabled = false;
+    optimization::CompileReport compileReport;
+    /// compiles the code, its statistics get merged into the compile report if it is enabled
+    std::unique_ptr<Function> compile(std::string_view code, std::span<const std::string_view> outputs);
     public:
     /// default constructor
     Pljit() = default;
-    /// gives back function
-    Handle registerFunction(std::string_view code);
-    Function registerFunctionAlternative(std::string_view code);
+    /// gives back handle to function, the function lives as long as the Pljit
+    /// the variables named in outputs can be given back by Function::evaluate
+    Handle registerFunction(std::string_view code, std::span<const std::string_view> outputs = {});
+    /// gives back function, the caller owns it
+    Function registerFunctionAlternative(std::string_view code, std::span<const std::string_view> outputs = {});
+    /// gives back names of all functions
+    const code_management::NamePool& getNamePool() const { return namePool; }
+    /// number of functions registered with registerFunction
+    size_t getFunctionCount() const;
+    /// bytes used by all functions registered with registerFunction, without the NamePool
+    size_t getMemoryUsage() const;
+    /// collect statistics of the optimization passes for all functions registered from now on
+    void setCompileReportEnabled(bool enabled) { compileReportEnabled = enabled; }
+    /// gives back the summed up statistics of the passes, without dumps
+    optimization::CompileReport getCompileReport() const;
+    /// fuses functions of this Pljit, parameters are matched by their names in the NamePool
+    /// if a function has compile errors, the fusion is invalid with a diagnostic
+    FusedFunction fuse(std::span<const Handle> handles) const;
 };
 
 
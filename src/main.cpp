@@ -1,111 +1,331 @@
 #include "6_lib_interface.hpp"
 #include "5_execution.hpp"
-#include "3_syntax_analysis.hpp"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <vector>
-#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 //---------------------------------------------------------------------------
 using namespace interface;
 //---------------------------------------------------------------------------
 
-int main() {
+/*
+ * command-line driver: pljit <function> <input> [<output>]
+ * evaluates the function for every row of a CSV/TSV file of arguments and writes one result per line
+ * the input gets mapped into memory, rows are evaluated in batches by the vectorized interpreter
+ * if the first line starts with a letter, it names the columns and they are matched with the parameters by name,
+ * else the columns are the parameters in order
+ * "-" reads the input from stdin, without an output file the results go to stdout
+ * a function without parameters gets evaluated once per non-empty line
+ * a division by zero stops at its row: the results in front of it are written and the line of the row is reported
+ */
 
+/// rows per batch, a few vectors of the interpreter
+static constexpr size_t batchRows = 16 * execution::VectorizedEvaluation::vectorSize;
 
-    // Test for Milestone 6
-    std::stringstream ss;
-    std::vector<std::string> sourceCode;
-    sourceCode.emplace_back("PARAM width, height, depth;\n");
-    sourceCode.emplace_back("VAR volume;\n");
-    sourceCode.emplace_back("CONST density = 2400;\n");
-    sourceCode.emplace_back("BEGIN\n");
-    sourceCode.emplace_back("\tvolume := width * height * depth;\n");
-    sourceCode.emplace_back("\tRETURN density * volume\n");
-    sourceCode.emplace_back("END.");
-    for(const std::string& line : sourceCode) {
-        ss << line;
-    }
-    std::string s = ss.str();
-    Pljit jit;
-    Function function = jit.registerFunctionAlternative(s);
-    std::cout << function({1,2,3}) << std::endl;
+/// input file mapped into memory, or read into a buffer if it can't be mapped (e.g. a pipe)
+class InputFile {
+    private:
+    void* mapping = MAP_FAILED;
+    size_t size = 0;
+    std::string buffer;
+    public:
+    /// opens the file, gives back false if it can't be read
+    bool open(const char* path);
+    /// destructor
+    ~InputFile() { if(mapping != MAP_FAILED) munmap(mapping, size); }
+    /// content of the file
+    std::string_view getContent() const { return mapping != MAP_FAILED ? std::string_view(static_cast<const char*>(mapping), size) : std::string_view(buffer); }
+};
+
+/// regular files get mapped, so the parser reads the page cache directly
+bool InputFile::open(const char* path) {
+    int fd = std::strcmp(path, "-") == 0 ? STDIN_FILENO : ::open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if(fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+        size = static_cast<size_t>(status.st_size);
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED) {
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            if(fd != STDIN_FILENO) {
+                close(fd);
+            }
+            return true;
+        }
+    }
+    char chunk[1 << 16];
+    ssize_t count;
+    while((count = read(fd, chunk, sizeof(chunk))) > 0) {
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+    if(fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return count == 0;
+}
 
-    /*
-    // Test for Milestone 3
-    std::vector<std::string_view> sourceCode;
-    sourceCode.emplace_back("PARAM width, height, depth;");
-    sourceCode.emplace_back("VAR volume;");
-    sourceCode.emplace_back("CONST density = 2400;");
-    //sourceCode.emplace_back("");
-    sourceCode.emplace_back("BEGIN");
-    sourceCode.emplace_back("\tvolume := width * height * depth;");
-    sourceCode.emplace_back("\tRETURN density * volume");
-    sourceCode.emplace_back("END.");
-    CodeManager codeManager(sourceCode);
-    syntax_analysis::SyntaxAnalyser syntaxAnalyser(codeManager);
-    syntax_analysis::FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition();
-    syntax_analysis::Print print;
-    print.visit(program);
-    */
+/// output which is only written when the buffer is full
+class OutputBuffer {
+    private:
+    FILE* file;
+    std::vector<char> buffer;
+    size_t used = 0;
+    /// set by the first write which fails
+    bool failed = false;
+    public:
+    /// constructor
+    explicit OutputBuffer(FILE* file) : file(file), buffer(1 << 16) {}
+    /// writes one result per line
+    void write(int64_t value) {
+        // 20 chars for the value, 1 for the line break
+        if(buffer.size() - used < 21) {
+            flush();
+        }
+        char* end = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr;
+        *end++ = '\n';
+        used = end - buffer.data();
+    }
+    /// writes the buffer, gives back false if any write failed
+    bool flush() {
+        failed |= std::fwrite(buffer.data(), 1, used, file) != used;
+        used = 0;
+        return !failed;
+    }
+};
+
+/// true if all 8 bytes are digits, SWAR: each byte checked in the same register (no SIMD intrinsics), independent of the byte order
+static bool isEightDigits(uint64_t chunk) {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
 
-    /*
-    // Test for Milestone 3
-    std::vector<std::string_view> sourceCode;
-    sourceCode.emplace_back("BEGIN");
-    sourceCode.emplace_back("\tRETURN 5 * 10 * 6");
-    sourceCode.emplace_back("END.");
-    CodeManager codeManager(sourceCode);
-    syntax_analysis::SyntaxAnalyser syntaxAnalyser(codeManager);
-    syntax_analysis::FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition();
-    syntax_analysis::Print print;
-    print.visit(program);
-    */
+/// value of 8 digits in the order of the bytes in memory, 3 multiplications instead of 8
+/// only correct for little-endian loads, the first digit has to be the lowest byte
+static uint64_t parseEightDigits(uint64_t chunk) {
+    chunk = (chunk & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+    chunk = (chunk & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+    return (chunk & 0x0000FFFF0000FFFF) * 42949672960001 >> 32;
+}
+
+/// parses an optionally signed integer at p, on little-endian machines blocks of 8 digits at once while they fit before end
+/// gives back false if there is no number or it doesn't fit into int64_t
+static bool parseInt(const char*& p, const char* end, int64_t& value) {
+    bool negative = p < end && *p == '-';
+    if(p < end && (*p == '-' || *p == '+')) {
+        p++;
+    }
+    const char* begin = p;
+    uint64_t magnitude = 0;
+    if constexpr(std::endian::native == std::endian::little) {
+        // 16 digits still fit without overflow checks
+        while(end - p >= 8 && p - begin <= 8) {
+            uint64_t chunk;
+            std::memcpy(&chunk, p, 8);
+            if(!isEightDigits(chunk)) {
+                break;
+            }
+            magnitude = magnitude * 100000000 + parseEightDigits(chunk);
+            p += 8;
+        }
+    }
+    // the rest digit by digit, all digits on other machines
+    while(p < end && *p >= '0' && *p <= '9') {
+        uint64_t digit = static_cast<uint64_t>(*p - '0');
+        if(magnitude > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+        p++;
+    }
+    if(p == begin || magnitude > static_cast<uint64_t>(INT64_MAX) + negative) {
+        return false;
+    }
+    value = static_cast<int64_t>(negative ? 0 - magnitude : magnitude);
+    return true;
+}
 
-    /*
-    // Tests for Syntax Analysis
-    std::vector<std::string_view> sourceCode;
-    sourceCode.emplace_back("PARAM width, height, depth;");
-    sourceCode.emplace_back("VAR volume;");
-    sourceCode.emplace_back("CONST density = 2400;");
-    //sourceCode.emplace_back("");
-    sourceCode.emplace_back("BEGIN");
-    sourceCode.emplace_back("\tvolume := width * height * depth;");
-    sourceCode.emplace_back("\tRETURN density * volume");
-    sourceCode.emplace_back("END.");
-    CodeManager codeManager(sourceCode);
-    SyntaxAnalyser syntaxAnalyser(codeManager);
-    FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition();
-    */
+/// skips spaces and carriage returns around fields
+static void skipBlanks(const char*& p, const char* end) {
+    while(p < end && (*p == ' ' || *p == '\r')) {
+        p++;
+    }
+}
 
-    /*
-    /// Tests for Code Management
-    std::vector<std::string_view> vec;
-    vec.emplace_back("Hello World!");
-    code_management::CodeManager test = code_management::CodeManager(vec);
-    code_management::CodeFragment fragment = test.createCodeFragment(0, 0, 4);
-    fragment.print("error");
-    */
+int main(int argc, char** argv) {
+    if(argc < 3 || argc > 4) {
+        std::cerr << "usage: " << argv[0] << " <function> <input> [<output>]\n";
+        return 2;
+    }
+    InputFile sourceFile;
+    if(!sourceFile.open(argv[1])) {
+        std::cerr << argv[1] << ": can't read the function\n";
+        return 1;
+    }
+    // the source code has to stay alive for the diagnostics
+    std::string code(sourceFile.getContent());
+    Pljit jit;
+    Handle handle = jit.registerFunction(code);
+    const Function& function = handle.getFunction();
+    if(!function.isValid()) {
+        function.printDiagnostics(std::cerr);
+        return 1;
+    }
+    std::vector<std::string_view> parameterNames = function.getParameterNames();
+    execution::VectorizedEvaluation evaluation = function.createVectorizedEvaluation();
 
-    /*
-    /// Tests for Lexer
-    std::vector<std::string_view> sourceCode;
-    sourceCode.emplace_back("PARAM width, height, depth;");
-    sourceCode.emplace_back("END");
-    code_management::CodeManager codeManager(sourceCode);
-    lexical_analysis::Lexer lexer(codeManager);
-    for(unsigned i = 0; i < 7; ++i) {
-        auto token = lexer.next().value();
-        token.codeFragment.print("test:");
+    InputFile input;
+    if(!input.open(argv[2])) {
+        std::cerr << argv[2] << ": can't read the input\n";
+        return 1;
+    }
+    FILE* file = argc == 4 ? std::fopen(argv[3], "wb") : stdout;
+    if(!file) {
+        std::cerr << argv[3] << ": can't write the output\n";
+        return 1;
     }
+    OutputBuffer output(file);
+    // every error from here on goes through finish, so the results which were already evaluated still get written
+    auto finish = [&](int status) {
+        bool written = output.flush();
+        if(argc == 4) {
+            written &= std::fclose(file) == 0;
+        } else {
+            written &= std::fflush(file) == 0;
+        }
+        if(!written) {
+            std::cerr << "can't write the results\n";
+            return 1;
+        }
+        return status;
+    };
 
-    std::vector<std::string_view> source;
-    source.emplace_back("Hello");
-    CodeManager codeManager = CodeManager(source);
-    CodeFragment codeFragment = codeManager.createCodeFragment(0, 1);
-    Keyword token = Keyword(codeFragment, Keyword::Keywords::PARAM);
-    Token* keyword1 = &token;
-    const Keyword* keyword2 = getKeywordDynamic(keyword1);
-    std::cout << keyword2->codeFragment.getString() << std::endl;
-    */
+    std::string_view content = input.getContent();
+    const char* p = content.data();
+    const char* end = p + content.size();
+    std::string_view firstLine = content.substr(0, content.find('\n'));
+    char delimiter = firstLine.find('\t') != std::string_view::npos ? '\t' : ',';
+    // parameter of each column, the columns are the parameters in order if there is no header
+    std::vector<size_t> parameterOfColumn;
+    std::vector<bool> covered(parameterNames.size(), false);
+    const char* firstNonBlank = p;
+    skipBlanks(firstNonBlank, end);
+    if(firstNonBlank < end && std::isalpha(static_cast<unsigned char>(*firstNonBlank))) {
+        // without parameters there is nothing to match, the header only gets skipped
+        size_t begin = parameterNames.empty() ? firstLine.size() + 1 : 0;
+        while(begin <= firstLine.size()) {
+            size_t next = std::min(firstLine.find(delimiter, begin), firstLine.size());
+            std::string_view name = firstLine.substr(begin, next - begin);
+            while(!name.empty() && (name.front() == ' ' || name.front() == '\r')) name.remove_prefix(1);
+            while(!name.empty() && (name.back() == ' ' || name.back() == '\r')) name.remove_suffix(1);
+            size_t parameter = 0;
+            while(parameter < parameterNames.size() && parameterNames[parameter] != name) {
+                parameter++;
+            }
+            if(parameter == parameterNames.size()) {
+                std::cerr << argv[2] << ": column " << name << " is no parameter\n";
+                return finish(1);
+            }
+            if(covered[parameter]) {
+                std::cerr << argv[2] << ": column " << name << " appears twice\n";
+                return finish(1);
+            }
+            covered[parameter] = true;
+            parameterOfColumn.push_back(parameter);
+            begin = next + 1;
+        }
+        p += std::min(firstLine.size() + 1, content.size());
+    } else {
+        for(size_t parameter = 0; parameter < parameterNames.size(); parameter++) {
+            parameterOfColumn.push_back(parameter);
+            covered[parameter] = true;
+        }
+    }
+    for(size_t parameter = 0; parameter < parameterNames.size(); parameter++) {
+        if(!covered[parameter]) {
+            std::cerr << argv[2] << ": no column for parameter " << parameterNames[parameter] << "\n";
+            return finish(1);
+        }
+    }
 
+    std::vector<std::vector<int64_t>> columns(parameterNames.size(), std::vector<int64_t>(batchRows));
+    std::vector<std::span<const int64_t>> columnSpans(parameterNames.size());
+    std::vector<int64_t> results(batchRows);
+    // line of the next row and of each row in the batch, for error messages
+    size_t line = p == content.data() ? 1 : 2;
+    std::vector<size_t> lineOfRow(batchRows);
+    // gives back false if a division traps, the results in front of its row are written anyway
+    auto evaluateBatch = [&](size_t rows) {
+        for(size_t parameter = 0; parameter < columns.size(); parameter++) {
+            columnSpans[parameter] = std::span<const int64_t>(columns[parameter].data(), rows);
+        }
+        std::span<int64_t> batchResults(results.data(), rows);
+        size_t evaluated = evaluation.evaluate(columnSpans, batchResults);
+        for(size_t row = 0; row < evaluated; row++) {
+            output.write(results[row]);
+        }
+        if(evaluated < rows) {
+            std::cerr << argv[2] << ":" << lineOfRow[evaluated] << ": division by zero or overflow\n";
+            return false;
+        }
+        return true;
+    };
+    size_t rows = 0;
+    // the rows in front of a malformed line still get evaluated and written, unless one of them traps first
+    auto malformed = [&](const auto&... message) {
+        if(evaluateBatch(rows)) {
+            ((std::cerr << argv[2] << ":" << line << ": ") << ... << message) << "\n";
+        }
+        return finish(1);
+    };
+    while(p < end) {
+        skipBlanks(p, end);
+        if(p < end && *p == '\n') {
+            // empty line
+            p++;
+            line++;
+            continue;
+        }
+        if(parameterOfColumn.empty()) {
+            // nothing to read, each line is one call
+            while(p < end && *p != '\n') {
+                p++;
+            }
+        }
+        for(size_t column = 0; column < parameterOfColumn.size(); column++) {
+            if(column > 0) {
+                if(p == end || *p != delimiter) {
+                    return malformed("expected ", parameterOfColumn.size(), " fields");
+                }
+                p++;
+                skipBlanks(p, end);
+            }
+            if(!parseInt(p, end, columns[parameterOfColumn[column]][rows])) {
+                return malformed("field ", column + 1, " is no 64-bit integer");
+            }
+            skipBlanks(p, end);
+        }
+        if(p < end && *p != '\n') {
+            return malformed("expected ", parameterOfColumn.size(), " fields");
+        }
+        p += p < end;
+        lineOfRow[rows] = line++;
+        if(++rows == batchRows) {
+            if(!evaluateBatch(rows)) {
+                return finish(1);
+            }
+            rows = 0;
+        }
+    }
+    return finish(evaluateBatch(rows) ? 0 : 1);
 }
 //---------------------------------------------------------------------------
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include "pljit/5_execution.hpp"
+#include <algorithm>
+#include <array>
+#include <string>
 
 using namespace execution;
 
@@ -9,7 +12,8 @@ TEST(Execution, simple) {
     sourceCode.emplace_back("RETURN 5");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    Evaluation evaluation(codeManager);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
     int64_t result = evaluation.evaluateFunction({});
     assert(result == 5);
 }
@@ -25,7 +29,8 @@ TEST(Execution, bigTest) {
     sourceCode.emplace_back("\tRETURN density * volume");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    Evaluation evaluation(codeManager);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
     int64_t result = evaluation.evaluateFunction({1,2,3});
     assert(result == (1*2*3*2400));
 }
@@ -37,15 +42,15 @@ TEST(Execution, constantPropagation1) {
     sourceCode.emplace_back("\tRETURN 5 * 10 * 6");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    Evaluation evaluation(codeManager);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
     int64_t result = evaluation.evaluateFunction({});
     assert(result == 300);
-    auto& function = evaluation.function;
-    const semantic_analysis::ReturnStatement* returnStatement = semantic_analysis::getReturnStatement(function->statement.get());
-    assert(returnStatement != nullptr);
-    const semantic_analysis::Literal* literal = semantic_analysis::getLiteral(returnStatement->arithmetic.get());
-    assert(literal != nullptr);
-    assert(literal->number == 300);
+    const optimization::Program& program = evaluation.program.value();
+    assert(program.instructions.size() == 1);
+    const optimization::Instruction& literal = program.instructions[program.result];
+    assert(literal.isConstant());
+    assert(literal.value == 300);
 }
 
 TEST(Execution, constantPropagation2) {
@@ -55,13 +60,162 @@ TEST(Execution, constantPropagation2) {
     sourceCode.emplace_back("\tRETURN 1 * 2 * var");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    Evaluation evaluation(codeManager);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
     int64_t result = evaluation.evaluateFunction({});
     assert(result == 10);
-    auto& function = evaluation.function;
-    const semantic_analysis::ReturnStatement* returnStatement = semantic_analysis::getReturnStatement(function->statement.get());
-    assert(returnStatement != nullptr);
-    const semantic_analysis::Literal* literal = semantic_analysis::getLiteral(returnStatement->arithmetic.get());
-    assert(literal != nullptr);
-    assert(literal->number == 10);
-}
\ No newline at end of file
+    const optimization::Program& program = evaluation.program.value();
+    assert(program.instructions.size() == 1);
+    const optimization::Instruction& literal = program.instructions[program.result];
+    assert(literal.isConstant());
+    assert(literal.value == 10);
+}
+TEST(Execution, longFunction) {
+    // long statement lists and operator chains must not exhaust the stack
+    constexpr unsigned count = 100000;
+    std::vector<std::string> lines;
+    lines.emplace_back("PARAM a;");
+    lines.emplace_back("VAR x;");
+    lines.emplace_back("BEGIN");
+    lines.emplace_back("\tx := a;");
+    for(unsigned i = 0; i < count; i++) {
+        lines.emplace_back("\tx := x + 1;");
+    }
+    std::string returnLine = "\tRETURN x";
+    for(unsigned i = 0; i < count; i++) {
+        returnLine += " + a * 1";
+    }
+    lines.push_back(std::move(returnLine));
+    lines.emplace_back("END.");
+    std::vector<std::string_view> sourceCode(lines.begin(), lines.end());
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
+    int64_t result = evaluation.evaluateFunction({2});
+    ASSERT_TRUE(result == 2 + count + 2 * count);
+}
+
+TEST(Execution, frame) {
+    // only the parameters stay in the frame, variables and constants are not set up per call
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM a, b;");
+    sourceCode.emplace_back("VAR unused, v;");
+    sourceCode.emplace_back("CONST c = 3, d = 4;");
+    sourceCode.emplace_back("BEGIN");
+    sourceCode.emplace_back("\tunused := a * d;");
+    sourceCode.emplace_back("\tv := a + b;");
+    sourceCode.emplace_back("\tRETURN v * c");
+    sourceCode.emplace_back("END.");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
+    ASSERT_TRUE(evaluation.getIdentifiers().size() == 2);
+    ASSERT_TRUE(evaluation.program->definitions.empty());
+    ASSERT_TRUE(evaluation.evaluateFunction({1, 2}) == 9);
+    ASSERT_TRUE(evaluation.evaluateFunction({5, -1}) == 12);
+    // the frame has no slot for more arguments, missing ones are 0
+    ASSERT_TRUE(evaluation.getParameterCount() == 2);
+    ASSERT_TRUE(evaluation.evaluateFunction({5}) == 15);
+}
+
+TEST(Execution, speculation) {
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM amount, divisor;");
+    sourceCode.emplace_back("BEGIN");
+    sourceCode.emplace_back("\tRETURN amount / divisor");
+    sourceCode.emplace_back("END.");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
+    Speculation speculation;
+    for(int64_t i = 0; i < Speculation::initialWindow; i++) {
+        std::array<int64_t, 2> arguments{i * 7, 1000};
+        ASSERT_TRUE(speculation.evaluate(evaluation, arguments) == i * 7 / 1000);
+    }
+    // the divisor was always 1000, amount changed on every call
+    const Evaluation* specialized = speculation.getSpecialized();
+    ASSERT_TRUE(specialized != nullptr);
+    ASSERT_TRUE(specialized->getIdentifiers().size() == 2);
+    for(const optimization::Instruction& instruction : specialized->program->instructions) {
+        ASSERT_TRUE(instruction.opcode != optimization::Instruction::Opcode::Divide);
+    }
+    ASSERT_TRUE(speculation.evaluate(evaluation, std::array<int64_t, 2>{-123456, 1000}) == -123);
+    // the guard sends other divisors to the generic version
+    ASSERT_TRUE(speculation.evaluate(evaluation, std::array<int64_t, 2>{100, 7}) == 14);
+    // too many guard failures drop the specialization
+    for(int64_t i = 0; i < Speculation::initialWindow; i++) {
+        std::array<int64_t, 2> arguments{i, i % 5 + 1};
+        ASSERT_TRUE(speculation.evaluate(evaluation, arguments) == i / (i % 5 + 1));
+    }
+    ASSERT_TRUE(speculation.getSpecialized() == nullptr);
+}
+
+TEST(Execution, incrementalEvaluation) {
+    // a long chain over a and a short one over b
+    std::vector<std::string> lines{"PARAM a, b, c;", "VAR x, y;", "BEGIN", "\tx := a;"};
+    for(unsigned i = 0; i < 100; i++) {
+        lines.push_back("\tx := x * " + std::to_string(i % 7 + 2) + " - a / 3;");
+    }
+    lines.insert(lines.end(), {"\ty := b * c - 1;", "\tRETURN x + y * 0 / 4 + y", "END."});
+    std::vector<std::string_view> sourceCode(lines.begin(), lines.end());
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
+    std::array<int64_t, 3> arguments{5, 6, 7};
+    IncrementalEvaluation incremental(evaluation, arguments);
+    ASSERT_TRUE(incremental.getResult() == evaluation.evaluateFunction(arguments));
+    size_t programSize = incremental.getRecomputedCount();
+    // b only reaches y and the result
+    arguments[1] = -2;
+    ASSERT_TRUE(incremental.update(1, -2) == evaluation.evaluateFunction(arguments));
+    ASSERT_TRUE(incremental.getRecomputedCount() < 6);
+    // unchanged values stop the propagation
+    ASSERT_TRUE(incremental.update(1, -2) == evaluation.evaluateFunction(arguments));
+    ASSERT_TRUE(incremental.getRecomputedCount() == 1);
+    arguments[0] = 11;
+    ASSERT_TRUE(incremental.update(0, 11) == evaluation.evaluateFunction(arguments));
+    ASSERT_TRUE(incremental.getRecomputedCount() > programSize / 2);
+    arguments[2] = 3;
+    ASSERT_TRUE(incremental.update(2, 3) == evaluation.evaluateFunction(arguments));
+}
+
+TEST(Execution, vectorizedEvaluation) {
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM a, b, c;");
+    sourceCode.emplace_back("VAR x, y;");
+    sourceCode.emplace_back("BEGIN");
+    sourceCode.emplace_back("\tx := a * b - c / 3 + -a;");
+    sourceCode.emplace_back("\ty := x * x / c - 7 * b + a / 8;");
+    sourceCode.emplace_back("\tx := (x + y) * (x - y) / (c + 1000) * 6;");
+    sourceCode.emplace_back("\tRETURN x - y + 1000000 / c");
+    sourceCode.emplace_back("END.");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Evaluation evaluation(codeManager, diagnostics);
+    VectorizedEvaluation vectorized(evaluation);
+    // the values live only for a few instructions
+    ASSERT_TRUE(vectorized.getVectorCount() < evaluation.program->instructions.size() / 2);
+    // more rows than one vector and not a multiple of it
+    size_t rows = 2 * VectorizedEvaluation::vectorSize + 17;
+    std::vector<int64_t> a(rows), b(rows), c(rows);
+    for(size_t r = 0; r < rows; r++) {
+        int64_t row = static_cast<int64_t>(r);
+        a[r] = row * 37 - 5000;
+        b[r] = (row * 101) % 977 - 400;
+        c[r] = row % 2 ? row + 1 : -row - 1;
+    }
+    std::array<std::span<const int64_t>, 3> columns{a, b, c};
+    std::vector<int64_t> results(rows);
+    ASSERT_TRUE(vectorized.evaluate(columns, results) == rows);
+    for(size_t r = 0; r < rows; r++) {
+        ASSERT_TRUE(results[r] == evaluation.evaluateFunction({a[r], b[r], c[r]}));
+    }
+    // the evaluation stops in front of the first row which would trap, the rows before it are complete
+    c[VectorizedEvaluation::vectorSize + 5] = 0;
+    c[VectorizedEvaluation::vectorSize + 9] = 0;
+    std::fill(results.begin(), results.end(), 0);
+    ASSERT_TRUE(vectorized.evaluate(columns, results) == VectorizedEvaluation::vectorSize + 5);
+    for(size_t r = 0; r < VectorizedEvaluation::vectorSize + 5; r++) {
+        ASSERT_TRUE(results[r] == evaluation.evaluateFunction({a[r], b[r], c[r]}));
+    }
+}
@@ -46,7 +46,8 @@ TEST(Lexer, simple) {
     sourceCode.emplace_back("PARAM width, height, depth;");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    Lexer lexer(codeManager);
+    Diagnostics diagnostics;
+    Lexer lexer(codeManager, diagnostics);
     std::unique_ptr<Token> token;
     Token* tokens;
 
@@ -99,7 +100,8 @@ TEST(Lexer, bigTest) {
     sourceCode.emplace_back("END.");
 
     CodeManager codeManager(sourceCode);
-    Lexer lexer(codeManager);
+    Diagnostics diagnostics;
+    Lexer lexer(codeManager, diagnostics);
     std::unique_ptr<Token> token;
     Token* tokens;
 
@@ -114,7 +116,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "width");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "width");
 
     token = lexer.next();
     tokens = token.get();
@@ -124,7 +126,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "height");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "height");
 
     token = lexer.next();
     tokens = token.get();
@@ -134,7 +136,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "depth");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "depth");
 
     token = lexer.next();
     tokens = token.get();
@@ -150,7 +152,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "volume");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "volume");
 
     token = lexer.next();
     tokens = token.get();
@@ -166,7 +168,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "density");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "density");
 
     token = lexer.next();
     tokens = token.get();
@@ -193,7 +195,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "volume");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "volume");
 
     token = lexer.next();
     tokens = token.get();
@@ -203,7 +205,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "width");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "width");
 
     token = lexer.next();
     tokens = token.get();
@@ -213,7 +215,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "height");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "height");
 
     token = lexer.next();
     tokens = token.get();
@@ -223,7 +225,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "depth");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "depth");
 
     token = lexer.next();
     tokens = token.get();
@@ -239,7 +241,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "density");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "density");
 
     token = lexer.next();
     tokens = token.get();
@@ -249,7 +251,7 @@ TEST(Lexer, bigTest) {
     token = lexer.next();
     tokens = token.get();
     ASSERT_TRUE(tokens->type == Token::Type::Identifier);
-    ASSERT_TRUE(tokens->codeFragment.getString() == "volume");
+    ASSERT_TRUE(codeManager.getString(tokens->codeFragment) == "volume");
 
     // seventh line
     token = lexer.next();
@@ -267,7 +269,8 @@ TEST(Lexer, stops) {
     std::vector<std::string_view> sourceCode;
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    Lexer lexer(codeManager);
+    Diagnostics diagnostics;
+    Lexer lexer(codeManager, diagnostics);
     ASSERT_TRUE(lexer.next()->type == Token::Type::Keyword);
     ASSERT_TRUE(lexer.next()->type == Token::Type::Separator);
     ASSERT_TRUE(lexer.next() == nullptr);
@@ -277,8 +280,62 @@ TEST(Lexer, deadCodeElimination) {
     std::vector<std::string_view> sourceCode;
     sourceCode.emplace_back("END. BEGIN RETURN 5");
     CodeManager codeManager(sourceCode);
-    Lexer lexer(codeManager);
+    Diagnostics diagnostics;
+    Lexer lexer(codeManager, diagnostics);
     ASSERT_TRUE(lexer.next()->type == Token::Type::Keyword);
     ASSERT_TRUE(lexer.next()->type == Token::Type::Separator);
     ASSERT_TRUE(lexer.next() == nullptr);
-}
\ No newline at end of file
+}
+TEST(Lexer, codeFragment) {
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM width;");
+    sourceCode.emplace_back("\tRETURN width");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Lexer lexer(codeManager, diagnostics);
+    lexer.next();
+    lexer.next();
+    lexer.next();
+    lexer.next();
+    std::unique_ptr<Token> token = lexer.next();
+    ASSERT_TRUE(codeManager.getString(token->codeFragment) == "width");
+    ASSERT_TRUE(codeManager.resolve(token->codeFragment) == CodeMarker(1, 8, 12));
+    ASSERT_TRUE(sizeof(token->codeFragment) == 8);
+}
+
+TEST(Lexer, nameTable) {
+    // ids are dense in order of first occurrence, equal names share an id
+    std::vector<std::string> names;
+    for(unsigned i = 0; i < 1000; i++) {
+        std::string name;
+        for(unsigned j = i; ; j /= 26) {
+            name += static_cast<char>('a' + j % 26);
+            if(j < 26) {
+                break;
+            }
+        }
+        names.push_back(name);
+    }
+    NameTable nameTable;
+    for(unsigned i = 0; i < names.size(); i++) {
+        ASSERT_TRUE(nameTable.intern(names[i]) == i);
+    }
+    for(unsigned i = 0; i < names.size(); i++) {
+        ASSERT_TRUE(nameTable.intern(names[i]) == i);
+        ASSERT_TRUE(nameTable.getName(i) == names[i]);
+    }
+    ASSERT_TRUE(nameTable.size() == names.size());
+
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM width, height; BEGIN RETURN height * width END.");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    Lexer lexer(codeManager, diagnostics);
+    std::vector<unsigned> nameIds;
+    for(auto token = lexer.next(); token; token = lexer.next()) {
+        if(token->type == Token::Type::Identifier) {
+            nameIds.push_back(static_cast<const Identifier*>(token.get())->nameId);
+        }
+    }
+    ASSERT_TRUE((nameIds == std::vector<unsigned>{0, 1, 1, 0}));
+}
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include "pljit/1_code_management.hpp"
 #include "pljit/6_lib_interface.hpp"
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <thread>
 
 using namespace interface;
 
@@ -51,4 +55,269 @@ TEST(Interface, bigTest2) {
     Function function = jit.registerFunctionAlternative(s);
     int64_t result = function({-5,2,3});
     assert(result == (-5 * (2 / 3) * 3));
-}
\ No newline at end of file
+}
+TEST(Interface, diagnostics) {
+    std::string code = "PARAM a;\nBEGIN\nRETURN b\nEND.";
+    Pljit jit;
+    Function function = jit.registerFunctionAlternative(code);
+    ASSERT_FALSE(function.isValid());
+    auto diagnostics = function.getDiagnostics().getDiagnostics();
+    ASSERT_TRUE(diagnostics.size() == 1);
+    ASSERT_TRUE(diagnostics[0].message == "error: identifier is not defined!");
+    std::stringstream ss;
+    function.printDiagnostics(ss);
+    ASSERT_TRUE(ss.str() == "2:7: error: identifier is not defined!\n\tRETURN b\n\t       ^\n");
+}
+
+TEST(Interface, handle) {
+    std::string code = "PARAM width, height;\nBEGIN\nRETURN width * height\nEND.";
+    Pljit jit;
+    Handle handle = jit.registerFunction(code);
+    ASSERT_TRUE(handle({4, 5}) == 20);
+}
+
+TEST(Interface, namePool) {
+    Pljit jit;
+    auto code = std::make_unique<std::string>("PARAM width, height;\nVAR volume;\nBEGIN\nvolume := width * height;\nRETURN volume\nEND.");
+    Function function1 = jit.registerFunctionAlternative(*code);
+    Function function2 = jit.registerFunctionAlternative("PARAM height, depth;\nBEGIN\nRETURN height + depth\nEND.");
+    // names are shared by all functions
+    ASSERT_TRUE(jit.getNamePool().size() == 4);
+    // names don't depend on the source code
+    std::fill(code->begin(), code->end(), '#');
+    code.reset();
+    ASSERT_TRUE((function1.getParameterNames() == std::vector<std::string_view>{"width", "height"}));
+    ASSERT_TRUE((function2.getParameterNames() == std::vector<std::string_view>{"height", "depth"}));
+    ASSERT_TRUE(function1({2, 3}) == 6);
+}
+
+TEST(Interface, concurrentRegistration) {
+    Pljit jit;
+    std::vector<std::thread> threads;
+    std::vector<int64_t> results(8);
+    for(unsigned i = 0; i < results.size(); i++) {
+        threads.emplace_back([&jit, &results, i] {
+            std::string name(1, static_cast<char>('b' + i));
+            std::string code = "PARAM a, " + name + ";\nBEGIN\nRETURN a * " + name + "\nEND.";
+            Handle handle = jit.registerFunction(code);
+            results[i] = handle({2, static_cast<int64_t>(i)});
+        });
+    }
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+    for(unsigned i = 0; i < results.size(); i++) {
+        ASSERT_TRUE(results[i] == 2 * static_cast<int64_t>(i));
+    }
+    // "a" + one name per thread
+    ASSERT_TRUE(jit.getNamePool().size() == 1 + results.size());
+}
+
+TEST(Interface, memoryUsage) {
+    Pljit jit;
+    std::string code = "PARAM a;\nBEGIN\nRETURN a * 2\nEND.";
+    for(unsigned i = 0; i < 100; i++) {
+        jit.registerFunction(code);
+    }
+    ASSERT_TRUE(jit.getFunctionCount() == 100);
+    size_t bytesPerFunction = jit.getMemoryUsage() / jit.getFunctionCount();
+    // only the Function object, a few AST nodes and the identifiers are left
+    ASSERT_TRUE(bytesPerFunction > sizeof(Function));
+    ASSERT_TRUE(bytesPerFunction < 512);
+}
+
+TEST(Interface, compileReport) {
+    Pljit jit;
+    jit.registerFunction("PARAM a;\nBEGIN\nRETURN a * 2\nEND.");
+    ASSERT_TRUE(jit.getCompileReport().programs == 0);
+    jit.setCompileReportEnabled(true);
+    jit.registerFunction("PARAM a;\nBEGIN\nRETURN a * 2\nEND.");
+    jit.registerFunctionAlternative("PARAM a;\nBEGIN\nRETURN a * (1 + 2)\nEND.");
+    // invalid code never reaches the optimizer
+    jit.registerFunction("BEGIN\nRETURN b\nEND.");
+    optimization::CompileReport report = jit.getCompileReport();
+    ASSERT_TRUE(report.programs == 2);
+    ASSERT_TRUE(!report.passes.empty() && report.passes.front().runs == 2);
+    std::ostringstream out;
+    report.print(out);
+    ASSERT_TRUE(out.str().find("round 0 ConstantPropagation: 2 runs") != std::string::npos);
+}
+
+TEST(Interface, specialize) {
+    Pljit jit;
+    Function function = jit.registerFunctionAlternative("PARAM width, height, depth;\nVAR volume;\nCONST density = 2400;\nBEGIN\n\tvolume := width * height * depth;\n\tRETURN density * volume\nEND.");
+    Function specialized = function.specialize({{"depth", 3}});
+    ASSERT_TRUE(specialized.isValid());
+    ASSERT_TRUE(specialized.getParameterNames() == std::vector<std::string_view>({"width", "height"}));
+    ASSERT_TRUE(specialized({1, 2}) == function({1, 2, 3}));
+    // all parameters fixed, only a constant is left
+    Function constant = specialized.specialize({{"width", 5}, {"height", 7}});
+    ASSERT_TRUE(constant.getParameterNames().empty());
+    ASSERT_TRUE(constant() == 2400 * 5 * 7 * 3);
+    ASSERT_TRUE(constant.getMemoryUsage() < function.getMemoryUsage());
+    // depth is no parameter of the specialized function anymore
+    Function invalid = specialized.specialize({{"depth", 4}});
+    ASSERT_TRUE(!invalid.isValid());
+    ASSERT_TRUE(invalid.getDiagnostics().getDiagnostics().size() == 1);
+    std::ostringstream out;
+    invalid.printDiagnostics(out);
+    ASSERT_TRUE(out.str() == "error: unknown parameter in specialization!\n");
+    // a function with compile errors can't be specialized
+    Function broken = jit.registerFunctionAlternative("PARAM a;\nBEGIN\n\tRETURN b\nEND.");
+    Function brokenSpecialized = broken.specialize({});
+    ASSERT_TRUE(!brokenSpecialized.isValid());
+    ASSERT_TRUE(brokenSpecialized.getDiagnostics().getDiagnostics().size() == 1);
+}
+
+TEST(Interface, multipleOutputs) {
+    Pljit jit;
+    std::array<std::string_view, 2> outputNames{"volume", "unused"};
+    Function function = jit.registerFunctionAlternative("PARAM width, height, depth;\nVAR unused, volume;\nCONST density = 2400;\nBEGIN\n\tvolume := width * height * depth;\n\tRETURN density * volume\nEND.", outputNames);
+    ASSERT_TRUE(function.isValid());
+    ASSERT_TRUE(function.getOutputCount() == 3);
+    std::array<int64_t, 3> arguments{2, 3, 4};
+    std::array<int64_t, 3> outputs{};
+    function.evaluate(arguments, outputs);
+    // volume, the initial value of unused, the result
+    ASSERT_TRUE(outputs[0] == 24 && outputs[1] == 0 && outputs[2] == 2400 * 24);
+    ASSERT_TRUE(function({1, 1, 1}) == 2400);
+    // only variables can be outputs
+    std::array<std::string_view, 1> constant{"density"};
+    Function invalid = jit.registerFunctionAlternative("PARAM a;\nCONST density = 2400;\nBEGIN\n\tRETURN density * a\nEND.", constant);
+    ASSERT_TRUE(!invalid.isValid());
+    // the name comes from the caller, so the error doesn't point into the code
+    std::ostringstream out;
+    invalid.printDiagnostics(out);
+    ASSERT_TRUE(out.str() == "error: output is not a variable!\n");
+}
+
+TEST(Interface, resultCache) {
+    Pljit jit;
+    Handle handle = jit.registerFunction("PARAM a, b;\nBEGIN\nRETURN a * a + b / 2\nEND.");
+    ASSERT_TRUE(handle.getCacheStatistics().misses == 0);
+    handle.enableResultCache(64);
+    for(unsigned round = 0; round < 3; round++) {
+        for(int64_t i = 0; i < 10; i++) {
+            ASSERT_TRUE(handle({i, 5}) == i * i + 2);
+        }
+    }
+    ResultCache::Statistics statistics = handle.getCacheStatistics();
+    ASSERT_TRUE(statistics.misses == 10 && statistics.hits == 20 && statistics.evictions == 0);
+    // missing arguments are 0, like for the evaluation
+    ASSERT_TRUE(handle({3}) == 9);
+    ASSERT_TRUE(handle({3, 0}) == 9);
+    ASSERT_TRUE(handle.getCacheStatistics().hits == 21);
+    handle.disableResultCache();
+    ASSERT_TRUE(handle({3, 0}) == 9);
+    ASSERT_TRUE(handle.getCacheStatistics().hits == 0);
+
+    // more tuples than entries evict, the results stay correct
+    ResultCache cache(2, 1);
+    ASSERT_TRUE(cache.getCapacity() == ResultCache::shardCount * ResultCache::ways);
+    for(int64_t i = 0; i < 1000; i++) {
+        std::array<int64_t, 2> arguments{i, -i};
+        if(std::optional<int64_t> result = cache.lookup(arguments)) {
+            ASSERT_TRUE(*result == 2 * i);
+        } else {
+            cache.insert(arguments, 2 * i);
+        }
+    }
+    ASSERT_TRUE(cache.getStatistics().evictions >= 1000 - cache.getCapacity());
+    std::array<int64_t, 2> last{999, -999};
+    ASSERT_TRUE(cache.lookup(last) == 2 * 999);
+
+    // the shards have their own locks, so one cache can be shared by threads
+    ResultCache shared(1, 256);
+    std::vector<std::thread> threads;
+    std::array<bool, 4> correct{};
+    for(size_t t = 0; t < correct.size(); t++) {
+        threads.emplace_back([&shared, &correct, t] {
+            correct[t] = true;
+            for(int64_t i = 0; i < 10000; i++) {
+                std::array<int64_t, 1> arguments{i % 500};
+                if(std::optional<int64_t> result = shared.lookup(arguments)) {
+                    correct[t] &= *result == 3 * arguments[0];
+                } else {
+                    shared.insert(arguments, 3 * arguments[0]);
+                }
+            }
+        });
+    }
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_TRUE(std::all_of(correct.begin(), correct.end(), [](bool c) { return c; }));
+    ResultCache::Statistics sharedStatistics = shared.getStatistics();
+    ASSERT_TRUE(sharedStatistics.hits + sharedStatistics.misses == 4 * 10000);
+}
+
+TEST(Interface, disableSpeculation) {
+    Pljit jit;
+    Function function = jit.registerFunctionAlternative("PARAM a, b;\nBEGIN\nRETURN a / b\nEND.");
+    for(int64_t i = 0; i < 2 * execution::Speculation::initialWindow; i++) {
+        ASSERT_TRUE(function({i, 1000}) == i / 1000);
+    }
+    ASSERT_TRUE(function.getSpeculation());
+    // without profiling, calls only run the generic version
+    function.disableSpeculation();
+    ASSERT_TRUE(!function.getSpeculation());
+    for(int64_t i = 0; i < 2 * execution::Speculation::initialWindow; i++) {
+        ASSERT_TRUE(function({i, 1000}) == i / 1000);
+    }
+    ASSERT_TRUE(!function.getSpeculation());
+}
+
+TEST(Interface, constantFunction) {
+    Pljit jit;
+    Function product = jit.registerFunctionAlternative("BEGIN\n\tRETURN 5 * 10 * 6\nEND.");
+    ASSERT_TRUE(product.isConstant() && product() == 300);
+    // variables which only depend on constants get folded as well
+    Function chain = jit.registerFunctionAlternative("VAR x;\nCONST c = 3;\nBEGIN\n\tx := c * 2;\n\tx := x + 1;\n\tRETURN x * x\nEND.");
+    ASSERT_TRUE(chain.isConstant() && chain() == 49);
+    ASSERT_TRUE(chain.getMemoryUsage() <= product.getMemoryUsage());
+    // the division has to trap when it gets called
+    Function division = jit.registerFunctionAlternative("BEGIN\n\tRETURN 1 / 0\nEND.");
+    ASSERT_TRUE(division.isValid() && !division.isConstant());
+    Function parameter = jit.registerFunctionAlternative("PARAM a;\nBEGIN\n\tRETURN a\nEND.");
+    ASSERT_TRUE(!parameter.isConstant());
+    // the selected variables still get their values, even if the result alone would be constant
+    std::array<std::string_view, 1> outputNames{"v"};
+    Function outputs = jit.registerFunctionAlternative("VAR v;\nBEGIN\n\tRETURN 5\nEND.", outputNames);
+    std::array<int64_t, 2> values{1, 1};
+    outputs.evaluate({}, values);
+    ASSERT_TRUE(values[0] == 0 && values[1] == 5);
+}
+
+TEST(Interface, fusedFunctions) {
+    Pljit jit;
+    std::array<Handle, 3> handles{
+        jit.registerFunction("PARAM width, height, depth;\nVAR volume;\nCONST density = 2400;\nBEGIN\n\tvolume := width * height * depth;\n\tRETURN density * volume\nEND."),
+        jit.registerFunction("PARAM height, depth;\nBEGIN\n\tRETURN height * depth + 1\nEND."),
+        jit.registerFunction("BEGIN\n\tRETURN 42\nEND.")};
+    FusedFunction fused = jit.fuse(handles);
+    ASSERT_TRUE(fused.isValid());
+    ASSERT_TRUE(fused.getParameterNames() == std::vector<std::string_view>({"width", "height", "depth"}));
+    // height * depth and the parameters are only computed once
+    ASSERT_TRUE(fused.getInstructionCount() == 10);
+    size_t rows = 3000;
+    std::vector<int64_t> width(rows), height(rows), depth(rows);
+    for(size_t r = 0; r < rows; r++) {
+        width[r] = static_cast<int64_t>(r);
+        height[r] = static_cast<int64_t>(r % 13) - 6;
+        depth[r] = static_cast<int64_t>(r * 7 % 101);
+    }
+    std::array<std::span<const int64_t>, 3> columns{width, height, depth};
+    std::vector<int64_t> volumes(rows), sums(rows), constants(rows);
+    std::array<std::span<int64_t>, 3> outputs{volumes, sums, constants};
+    fused.evaluate(columns, outputs);
+    for(size_t r = 0; r < rows; r++) {
+        ASSERT_TRUE(volumes[r] == handles[0]({width[r], height[r], depth[r]}));
+        ASSERT_TRUE(sums[r] == handles[1]({height[r], depth[r]}));
+        ASSERT_TRUE(constants[r] == 42);
+    }
+    // a function with compile errors makes the fusion invalid
+    std::array<Handle, 2> invalid{handles[1], jit.registerFunction("PARAM a;\nBEGIN\n\tRETURN b\nEND.")};
+    FusedFunction failed = jit.fuse(invalid);
+    ASSERT_TRUE(!failed.isValid());
+    ASSERT_TRUE(failed.getDiagnostics().getDiagnostics().size() == 1);
+}
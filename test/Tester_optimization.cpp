@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+#include "pljit/1_code_management.hpp"
+#include "pljit/4_semantic_analysis.hpp"
+#include "pljit/5_optimization.hpp"
+#include <algorithm>
+#include <sstream>
+
+using namespace optimization;
+
+/// lowers the source code without running any pass
+static Program lower(std::vector<std::string_view> sourceCode, std::vector<semantic_analysis::Identifier>& identifiers) {
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    semantic_analysis::SinglePassAnalyser singlePassAnalyser(codeManager, diagnostics);
+    std::unique_ptr<semantic_analysis::Function> function = singlePassAnalyser.analyseFunction();
+    assert(function != nullptr);
+    identifiers = singlePassAnalyser.symbolTable.identifiers;
+    return Program(*function, identifiers);
+}
+
+TEST(Optimization, ssaVersions) {
+    // every assignment defines a new version, reads refer to the current one
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM a;", "VAR v;", "BEGIN", "\tv := a + v;", "\tv := v * a;", "\tRETURN v", "END."}, identifiers);
+    ASSERT_TRUE(program.definitions.size() == 2);
+    const Definition& first = program.definitions[0];
+    const Definition& second = program.definitions[1];
+    ASSERT_TRUE(first.slot == 1 && second.slot == 1);
+    ASSERT_TRUE(program.result == second.value);
+    const Instruction& add = program.instructions[first.value];
+    ASSERT_TRUE(add.opcode == Instruction::Opcode::Add);
+    ASSERT_TRUE(program.instructions[add.left].opcode == Instruction::Opcode::Parameter);
+    // unassigned variable reads its initial value
+    ASSERT_TRUE(program.instructions[add.right].isConstant());
+    ASSERT_TRUE(program.instructions[add.right].value == 0);
+    const Instruction& multiply = program.instructions[second.value];
+    ASSERT_TRUE(multiply.opcode == Instruction::Opcode::Multiply);
+    ASSERT_TRUE(multiply.left == first.value);
+    // the parameter is only loaded once
+    ASSERT_TRUE(multiply.right == add.left);
+
+    DefUse defUse(program);
+    ASSERT_TRUE(defUse.getUsers(add.left).size() == 2);
+    ASSERT_TRUE(defUse.getUsers(first.value).size() == 1);
+    ASSERT_TRUE(defUse.getUsers(first.value)[0] == second.value);
+    ASSERT_TRUE(defUse.getUsers(second.value).empty());
+    ASSERT_TRUE(defUse.isUsed(second.value));
+}
+
+/// counts how often it was run
+class CountingPass : public Optimization {
+    public:
+    std::vector<std::string_view>& log;
+    explicit CountingPass(std::vector<std::string_view>& log) : log(log) {}
+    std::string_view getName() const override { return "CountingPass"; }
+    void optimize(Program&) override { log.push_back(getName()); }
+};
+
+TEST(Optimization, passManager) {
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM a;", "CONST c = 4;", "BEGIN", "\tRETURN -(c * 2) + a * (1 + 2)", "END."}, identifiers);
+    std::vector<std::string_view> log;
+    PassManager passManager;
+    passManager.addPass(std::make_unique<ConstantPropagation>());
+    passManager.addPass(std::make_unique<CountingPass>(log));
+    passManager.run(program);
+    ASSERT_TRUE(log.size() == 1);
+    // folded operands are removed: -8, param a, 3, a * 3, sum
+    ASSERT_TRUE(program.instructions.size() == 5);
+    const Instruction& add = program.instructions[program.result];
+    ASSERT_TRUE(add.opcode == Instruction::Opcode::Add);
+    ASSERT_TRUE(program.instructions[add.left].isConstant());
+    ASSERT_TRUE(program.instructions[add.left].value == -8);
+    const Instruction& multiply = program.instructions[add.right];
+    ASSERT_TRUE(multiply.opcode == Instruction::Opcode::Multiply);
+    ASSERT_TRUE(program.instructions[multiply.right].value == 3);
+    std::stringstream ss;
+    program.print(ss, identifiers);
+    ASSERT_TRUE(ss.str().find("param a") != std::string::npos);
+}
+
+TEST(Optimization, deadCodeElimination) {
+    // unused is never read, tmp is overwritten before it is read, only the last version is kept if observed
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM a, b;", "VAR unused, tmp, v;", "CONST c = 7;", "BEGIN", "\tunused := a * b;", "\ttmp := a / b;", "\ttmp := a - b;", "\tv := tmp + 1;", "\tRETURN tmp * c", "END."}, identifiers);
+    ASSERT_TRUE(program.definitions.size() == 4);
+    Program observed = program;
+    PassManager passManager;
+    passManager.addPass(std::make_unique<DeadCodeElimination>());
+    passManager.run(program);
+    ASSERT_TRUE(program.definitions.empty());
+    // param a, param b, a / b (it traps if b is 0), a - b, 7, tmp * 7
+    ASSERT_TRUE(program.instructions.size() == 6);
+    ASSERT_TRUE(program.instructions[program.result].opcode == Instruction::Opcode::Multiply);
+
+    PassManager observingPassManager;
+    observingPassManager.addPass(std::make_unique<DeadCodeElimination>(std::vector<uint32_t>{3}));
+    observingPassManager.run(observed);
+    ASSERT_TRUE(observed.definitions.size() == 1);
+    ASSERT_TRUE(observed.definitions[0].slot == 3);
+    ASSERT_TRUE(observed.instructions[observed.definitions[0].value].opcode == Instruction::Opcode::Subtract);
+}
+
+TEST(Optimization, globalValueNumbering) {
+    // width * height is computed once, a * b after the redefinition of a is a different value
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM width, height, a, b;", "VAR area, v;", "BEGIN", "\tarea := width * height;", "\tv := a * b;", "\ta := v + 1;", "\tRETURN (height * width + area) * (a * b) - v", "END."}, identifiers);
+    PassManager passManager;
+    passManager.addPass(std::make_unique<DeadCodeElimination>());
+    passManager.addPass(std::make_unique<GlobalValueNumbering>());
+    passManager.run(program);
+    size_t multiplications = 0;
+    for(const Instruction& instruction : program.instructions) {
+        multiplications += instruction.opcode == Instruction::Opcode::Multiply;
+    }
+    // width * height, a * b, (a + 1) * b and the product of the sums
+    ASSERT_TRUE(multiplications == 4);
+    const Instruction& subtract = program.instructions[program.result];
+    const Instruction& product = program.instructions[subtract.left];
+    const Instruction& sum = program.instructions[product.left];
+    ASSERT_TRUE(sum.opcode == Instruction::Opcode::Add);
+    ASSERT_TRUE(sum.left == sum.right);
+    // v is the first a * b
+    ASSERT_TRUE(product.right != subtract.right);
+    ASSERT_TRUE(program.instructions[product.right].right == program.instructions[subtract.right].right);
+}
+
+TEST(Optimization, algebraicSimplification) {
+    // constants of the chains get grouped and folded, identities disappear
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM x, y;", "BEGIN", "\tRETURN (1 * 2 * x * 3 + 0) - -(-(y - y)) + (4 + x * 1 - 4)", "END."}, identifiers);
+    PassManager passManager = PassManager::createDefault();
+    passManager.run(program);
+    // operator chains lean right, so this is x * 6 - x, without anything left to fold
+    for(const Instruction& instruction : program.instructions) {
+        if(instruction.isBinary()) {
+            ASSERT_FALSE(program.instructions[instruction.left].isConstant() && program.instructions[instruction.right].isConstant());
+        }
+        ASSERT_TRUE(instruction.opcode != Instruction::Opcode::Negate);
+    }
+    ASSERT_TRUE(program.instructions.size() == 4);
+    const Instruction& subtract = program.instructions[program.result];
+    ASSERT_TRUE(subtract.opcode == Instruction::Opcode::Subtract);
+    ASSERT_TRUE(program.instructions[subtract.left].opcode == Instruction::Opcode::Multiply);
+    ASSERT_TRUE(program.instructions[program.instructions[subtract.left].right].value == 6);
+
+    // division by zero stays in the program, so it traps when it is executed
+    Program division = lower({"PARAM x;", "BEGIN", "\tRETURN x / (2 - 2) + 1 / 0 + x / -1", "END."}, identifiers);
+    passManager.run(division);
+    size_t divisions = 0;
+    for(const Instruction& instruction : division.instructions) {
+        divisions += instruction.opcode == Instruction::Opcode::Divide;
+    }
+    ASSERT_TRUE(divisions == 3);
+    // x * 0 and x - x still compute x if it could trap
+    Program dropped = lower({"PARAM x;", "BEGIN", "\tRETURN (x / 0) * 0 + ((x / 0) - (x / 0))", "END."}, identifiers);
+    passManager.run(dropped);
+    ASSERT_TRUE(!dropped.instructions[dropped.result].isConstant());
+    ASSERT_TRUE(std::any_of(dropped.instructions.begin(), dropped.instructions.end(), [](const Instruction& instruction) {
+        return instruction.opcode == Instruction::Opcode::Divide;
+    }));
+    // a dead store of a division which could trap isn't removed either
+    Program deadStore = lower({"PARAM x;", "VAR v;", "BEGIN", "\tv := x / 0;", "\tRETURN 5", "END."}, identifiers);
+    passManager.run(deadStore);
+    ASSERT_TRUE(deadStore.definitions.empty());
+    ASSERT_TRUE(std::any_of(deadStore.instructions.begin(), deadStore.instructions.end(), [](const Instruction& instruction) {
+        return instruction.opcode == Instruction::Opcode::Divide;
+    }));
+}
+
+TEST(Optimization, strengthReduction) {
+    // multiplications and divisions by constants compute the same as the generic instructions
+    std::vector<int64_t> dividends = {0, 1, -1, 2, -2, 3, -3, 7, -7, 100, -100, 12345678, -12345678, INT64_MAX, INT64_MIN, INT64_MAX - 1, INT64_MIN + 1, 1ll << 62, -(1ll << 62)};
+    for(int64_t i = 1; i < 64; i++) {
+        dividends.push_back(int64_t(1) << (i % 63));
+        dividends.push_back((int64_t(1) << (i % 63)) - 1);
+        dividends.push_back(-(int64_t(1) << (i % 63)) + 1);
+    }
+    std::vector<int64_t> divisors = {INT64_MAX, INT64_MIN + 1, 1ll << 62, -(1ll << 62), 1000, -1000, 641, 1ll << 32, 6700417};
+    for(int64_t divisor = -300; divisor <= 300; divisor++) {
+        divisors.push_back(divisor);
+    }
+    AlgebraicSimplification simplification;
+    for(int64_t divisor : divisors) {
+        if(divisor == 0) {
+            continue;
+        }
+        Program program;
+        uint32_t parameter = program.addInstruction(Instruction::parameter(0));
+        uint32_t constant = program.addInstruction(Instruction::constant(divisor));
+        uint32_t quotient = program.addInstruction(Instruction::binary(Instruction::Opcode::Divide, parameter, constant));
+        uint32_t product = program.addInstruction(Instruction::binary(Instruction::Opcode::Multiply, constant, parameter));
+        program.result = quotient;
+        program.definitions.push_back({1, product});
+        simplification.optimize(program);
+        const Instruction& division = program.instructions[program.result];
+        const Instruction& multiplication = program.instructions[program.definitions[0].value];
+        if(divisor > 1 || divisor < -1) {
+            ASSERT_TRUE(division.opcode == Instruction::Opcode::DivideByConstant || division.opcode == Instruction::Opcode::DivideByPowerOfTwo || divisor == INT64_MIN);
+        }
+        for(int64_t dividend : dividends) {
+            if(divisor == -1 && dividend == INT64_MIN) {
+                continue;
+            }
+            int64_t expected = dividend / divisor;
+            int64_t actual = division.isUnary() ? division.apply(dividend, 0) : division.opcode == Instruction::Opcode::Divide ? dividend / divisor : dividend;
+            ASSERT_EQ(actual, expected) << dividend << " / " << divisor;
+            int64_t expectedProduct = static_cast<int64_t>(static_cast<uint64_t>(dividend) * static_cast<uint64_t>(divisor));
+            int64_t actualProduct = multiplication.isUnary() ? multiplication.apply(dividend, 0)
+                : multiplication.isBinary() ? multiplication.apply(dividend, divisor)
+                : multiplication.isConstant() ? multiplication.value : dividend;
+            ASSERT_EQ(actualProduct, expectedProduct) << dividend << " * " << divisor;
+        }
+    }
+}
+
+TEST(Optimization, propagationThroughVariables) {
+    // constants and copies assigned to variables reach all later reads, the whole function collapses to one expression
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM a, b;", "VAR v, x, y, z;", "BEGIN", "\tv := 10 * 3;", "\tx := a;", "\ty := x;", "\tz := y * 1;", "\tb := v - 29;",
+        "\tRETURN (z + y - x) * b * v + (a * 2 * b - b * a * 2)", "END."}, identifiers);
+    PassManager::createDefault().run(program);
+    // a * (1 * 30), the difference only cancels after GVN merged a * b and b * a
+    ASSERT_TRUE(program.instructions.size() == 3);
+    const Instruction& multiply = program.instructions[program.result];
+    ASSERT_TRUE(multiply.opcode == Instruction::Opcode::Multiply);
+    ASSERT_TRUE(program.instructions[multiply.left].opcode == Instruction::Opcode::Parameter);
+    ASSERT_TRUE(program.instructions[multiply.left].left == 0);
+    ASSERT_TRUE(program.instructions[multiply.right].value == 30);
+}
+
+/// length of the longest chain of dependent instructions up to the value
+static unsigned height(const Program& program, uint32_t value) {
+    std::vector<unsigned> heights(program.instructions.size(), 0);
+    for(uint32_t i = 0; i <= value; i++) {
+        const Instruction& instruction = program.instructions[i];
+        if(instruction.isUnary()) {
+            heights[i] = heights[instruction.left] + 1;
+        } else if(instruction.isBinary()) {
+            heights[i] = std::max(heights[instruction.left], heights[instruction.right]) + 1;
+        }
+    }
+    return heights[value];
+}
+
+TEST(Optimization, treeHeightReduction) {
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM a, b, c, d, e, f, g, h;", "VAR v;", "BEGIN", "\tv := a * b * c * d * e * f * g * h;", "\tRETURN v + a + b + c + d - e - f - g", "END."}, identifiers);
+    ASSERT_TRUE(height(program, program.definitions[0].value) == 7);
+    ASSERT_TRUE(height(program, program.result) == 8);
+    PassManager passManager;
+    passManager.addFinalPass(std::make_unique<TreeHeightReduction>());
+    passManager.run(program);
+    // eight factors need three levels
+    ASSERT_TRUE(height(program, program.definitions[0].value) == 3);
+    // a + ((b + c) + (v + (d - (e - (f - g))))), the subtractions stay as they are
+    ASSERT_TRUE(height(program, program.result) == 6);
+    size_t multiplications = 0;
+    size_t subtractions = 0;
+    for(const Instruction& instruction : program.instructions) {
+        multiplications += instruction.opcode == Instruction::Opcode::Multiply;
+        subtractions += instruction.opcode == Instruction::Opcode::Subtract;
+    }
+    ASSERT_TRUE(multiplications == 7 && subtractions == 3);
+}
+
+TEST(Optimization, compileReport) {
+    std::vector<semantic_analysis::Identifier> identifiers;
+    Program program = lower({"PARAM a;", "VAR v;", "BEGIN", "\tv := 2 * 3;", "\tRETURN a * v + a * v", "END."}, identifiers);
+    CompileReport report;
+    report.dumpPrograms = true;
+    PassManager::createDefault().run(program, &report, identifiers);
+    ASSERT_TRUE(report.programs == 1);
+    ASSERT_TRUE(report.passes.front().name == "DeadCodeElimination" && report.passes.front().round == 0);
+    ASSERT_TRUE(report.passes[report.passes.size() - 2].name == "TreeHeightReduction");
+    ASSERT_TRUE(report.passes.back().name == "GlobalValueNumbering");
+    // every pass starts with the program its predecessor left
+    for(size_t i = 1; i < report.passes.size(); i++) {
+        ASSERT_TRUE(report.passes[i].instructionsBefore == report.passes[i - 1].instructionsAfter);
+    }
+    // the dead store of v and 2 * 3 get removed in the first round
+    ASSERT_TRUE(report.passes[0].rewrites == 1);
+    ASSERT_TRUE(report.passes[1].name == "ConstantPropagation" && report.passes[1].rewrites == 1);
+    ASSERT_TRUE(report.passes[2].name == "GlobalValueNumbering" && report.passes[2].rewrites >= 1);
+    std::ostringstream dump;
+    program.print(dump, identifiers);
+    ASSERT_TRUE(report.passes.back().dump == dump.str());
+
+    // merging sums up the same passes
+    CompileReport merged;
+    merged.merge(report);
+    merged.merge(report);
+    ASSERT_TRUE(merged.programs == 2 && merged.passes.size() == report.passes.size());
+    ASSERT_TRUE(merged.passes[1].runs == 2 && merged.passes[1].rewrites == 2);
+    ASSERT_TRUE(merged.passes[1].dump.empty());
+}
@@ -11,13 +11,15 @@ TEST(Semantics, simple) {
     sourceCode.emplace_back("RETURN 5");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    SemanticAnalyser semanticAnalyser(codeManager);
+    Diagnostics diagnostics;
+    SemanticAnalyser semanticAnalyser(codeManager, diagnostics);
     std::unique_ptr<Function> function = semanticAnalyser.analyseFunction();
-    const ReturnStatement* returnStatement = getReturnStatement(function->statement.get());
-    assert(returnStatement != nullptr);
-    const semantic_analysis::Literal* literal = getLiteral(returnStatement->arithmetic.get());
-    assert(literal != nullptr);
-    assert(literal->number == 5);
+    assert(function->statements.size() == 1);
+    const Statement& returnStatement = function->statements[0];
+    assert(returnStatement.isReturn());
+    const Node& literal = function->nodes[returnStatement.root()];
+    assert(literal.type == Node::Type::Literal);
+    assert(literal.number == 5);
 }
 
 TEST(Semantics, bigTest) {
@@ -31,41 +33,140 @@ TEST(Semantics, bigTest) {
     sourceCode.emplace_back("\tRETURN density * volume");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    SemanticAnalyser semanticAnalyser(codeManager);
+    Diagnostics diagnostics;
+    SemanticAnalyser semanticAnalyser(codeManager, diagnostics);
     std::unique_ptr<Function> function = semanticAnalyser.analyseFunction();
+    const std::vector<semantic_analysis::Identifier>& identifiers = semanticAnalyser.symbolTable.identifiers;
+    const std::vector<Node>& nodes = function->nodes;
 
-    /// Normal Statement has one AssignmentExpression and one ReturnStatement
-    const NormalStatement* normalStatement = getNormalStatement(function->statement.get());
-    assert(normalStatement != nullptr);
+    /// one NormalStatement and one ReturnStatement
+    assert(function->statements.size() == 2);
 
     /// AssignmentExpression
-    const AssignmentExpression* assignmentExpression = normalStatement->expression.get();
-    assert(assignmentExpression != nullptr);
-    assert(assignmentExpression->identifier == "volume");
-    const BinaryOperator* binaryOperator1 = getBinaryOperator(assignmentExpression->arithmetic.get());
-    assert(binaryOperator1 != nullptr);
-    assert(binaryOperator1->type == BinaryOperator::Type::Multiplication);
-    const IdentifierNode* identifier2 = getIdentifier(binaryOperator1->left.get());
-    assert(identifier2 != nullptr);
-    assert(identifier2->name == "width");
-    const BinaryOperator* binaryOperator2 = getBinaryOperator(binaryOperator1->right.get());
-    assert(binaryOperator2->type == BinaryOperator::Type::Multiplication);
-    const IdentifierNode* identifier3 = getIdentifier(binaryOperator2->left.get());
-    assert(identifier3->name == "height");
-    const IdentifierNode* identifier4 = getIdentifier(binaryOperator2->right.get());
-    assert(identifier4->name == "depth");
+    const Statement& normalStatement = function->statements[0];
+    assert(!normalStatement.isReturn());
+    assert(identifiers[normalStatement.target].name == "volume");
+    const Node& binaryOperator1 = nodes[normalStatement.root()];
+    assert(binaryOperator1.type == Node::Type::Multiplication);
+    const Node& identifier2 = nodes[binaryOperator1.left];
+    assert(identifier2.type == Node::Type::Identifier);
+    assert(identifiers[identifier2.left].name == "width");
+    const Node& binaryOperator2 = nodes[binaryOperator1.right];
+    assert(binaryOperator2.type == Node::Type::Multiplication);
+    assert(identifiers[nodes[binaryOperator2.left].left].name == "height");
+    assert(identifiers[nodes[binaryOperator2.right].left].name == "depth");
 
     /// Return Statement
-    const ReturnStatement* returnStatement = getReturnStatement(normalStatement->nextStatement.get());
-    assert(returnStatement != nullptr);
-    const BinaryOperator* binaryOperator3 = getBinaryOperator(returnStatement->arithmetic.get());
-    assert(binaryOperator3->type == BinaryOperator::Type::Multiplication);
-    const semantic_analysis::Literal* literal = getLiteral(binaryOperator3->left.get());
-    assert(literal != nullptr);
-    assert(literal->number == 2400);
-    const IdentifierNode* identifier6 = getIdentifier(binaryOperator3->right.get());
-    assert(identifier6 != nullptr);
-    assert(identifier6->name == "volume");
+    const Statement& returnStatement = function->statements[1];
+    assert(returnStatement.isReturn());
+    const Node& binaryOperator3 = nodes[returnStatement.root()];
+    assert(binaryOperator3.type == Node::Type::Multiplication);
+    const Node& literal = nodes[binaryOperator3.left];
+    assert(literal.type == Node::Type::Literal);
+    assert(literal.number == 2400);
+    const Node& identifier6 = nodes[binaryOperator3.right];
+    assert(identifier6.type == Node::Type::Identifier);
+    assert(identifiers[identifier6.left].name == "volume");
+}
+
+TEST(Semantics, singlePass) {
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM width, height, depth;");
+    sourceCode.emplace_back("VAR volume;");
+    sourceCode.emplace_back("CONST density = 2400, scale = 2;");
+    sourceCode.emplace_back("BEGIN");
+    sourceCode.emplace_back("\tvolume := width * (height - depth);");
+    sourceCode.emplace_back("\tRETURN density * volume / -scale");
+    sourceCode.emplace_back("END.");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    SinglePassAnalyser singlePassAnalyser(codeManager, diagnostics);
+    std::unique_ptr<Function> function = singlePassAnalyser.analyseFunction();
+    assert(singlePassAnalyser.count_parameters == 3);
+    assert(singlePassAnalyser.symbolTable.size() == 6);
 
+    const std::vector<semantic_analysis::Identifier>& identifiers = singlePassAnalyser.symbolTable.identifiers;
+    const std::vector<Node>& nodes = function->nodes;
+
+    /// AssignmentExpression
+    const Statement& normalStatement = function->statements[0];
+    assert(identifiers[normalStatement.target].name == "volume");
+    const Node& binaryOperator1 = nodes[normalStatement.root()];
+    assert(binaryOperator1.type == Node::Type::Multiplication);
+    assert(identifiers[nodes[binaryOperator1.left].left].name == "width");
+    const Node& binaryOperator2 = nodes[binaryOperator1.right];
+    assert(binaryOperator2.type == Node::Type::Minus);
+    assert(identifiers[nodes[binaryOperator2.left].left].name == "height");
+    assert(identifiers[nodes[binaryOperator2.right].left].name == "depth");
 
-}
\ No newline at end of file
+    /// Return Statement, constants are replaced by literals
+    const Statement& returnStatement = function->statements[1];
+    assert(returnStatement.isReturn());
+    const Node& binaryOperator3 = nodes[returnStatement.root()];
+    assert(binaryOperator3.type == Node::Type::Multiplication);
+    assert(nodes[binaryOperator3.left].number == 2400);
+    const Node& binaryOperator4 = nodes[binaryOperator3.right];
+    assert(binaryOperator4.type == Node::Type::Division);
+    assert(identifiers[nodes[binaryOperator4.left].left].name == "volume");
+    const Node& unaryOperator = nodes[binaryOperator4.right];
+    assert(unaryOperator.type == Node::Type::UnaryMinus);
+    assert(nodes[unaryOperator.left].type == Node::Type::Literal);
+    assert(nodes[unaryOperator.left].number == 2);
+}
+
+TEST(Semantics, diagnostics) {
+    // both analysers report errors without throwing, the buffer keeps all of them
+    std::vector<std::string_view> sourceCode1 = {"CONST c = 1;", "BEGIN c := 2; RETURN c END."};
+    std::vector<std::string_view> sourceCode2 = {"BEGIN RETURN 1 # END."};
+    CodeManager codeManager1(sourceCode1);
+    CodeManager codeManager2(sourceCode2);
+    Diagnostics diagnostics;
+    SemanticAnalyser semanticAnalyser(codeManager1, diagnostics);
+    ASSERT_TRUE(semanticAnalyser.analyseFunction() == nullptr);
+    SinglePassAnalyser singlePassAnalyser(codeManager2, diagnostics);
+    ASSERT_TRUE(singlePassAnalyser.analyseFunction() == nullptr);
+    auto errors = diagnostics.getDiagnostics();
+    ASSERT_TRUE(errors.size() == 2);
+    ASSERT_TRUE(errors[0].message == "error: identifier is constant!");
+    ASSERT_TRUE(codeManager1.resolve(errors[0].codeFragment) == CodeMarker(1, 6));
+    ASSERT_TRUE(errors[1].message == "error: unknown character");
+    ASSERT_TRUE(codeManager2.resolve(errors[1].codeFragment) == CodeMarker(0, 15));
+    diagnostics.clear();
+    ASSERT_FALSE(diagnostics.hasErrors());
+}
+
+TEST(Semantics, flatNodes) {
+    // nodes are 16 bytes, stored in post-order and the statements cover them without gaps
+    static_assert(sizeof(Node) == 16);
+    std::vector<std::string_view> sourceCode;
+    sourceCode.emplace_back("PARAM a, b;");
+    sourceCode.emplace_back("VAR c;");
+    sourceCode.emplace_back("BEGIN");
+    sourceCode.emplace_back("\tc := -(a + b) * a - b / 3;");
+    sourceCode.emplace_back("\tc := c + +1;");
+    sourceCode.emplace_back("\tRETURN c * (a - b)");
+    sourceCode.emplace_back("END.");
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    SinglePassAnalyser singlePassAnalyser(codeManager, diagnostics);
+    std::unique_ptr<Function> function = singlePassAnalyser.analyseFunction();
+    ASSERT_TRUE(function != nullptr);
+    ASSERT_TRUE(function->statements.size() == 3);
+    uint32_t begin = 0;
+    for(const Statement& statement : function->statements) {
+        ASSERT_TRUE(statement.begin == begin);
+        ASSERT_TRUE(statement.end > statement.begin);
+        for(uint32_t i = statement.begin; i < statement.end; i++) {
+            const Node& node = function->nodes[i];
+            if(node.isUnary() || node.isBinary()) {
+                ASSERT_TRUE(node.left >= statement.begin && node.left < i);
+            }
+            if(node.isBinary()) {
+                ASSERT_TRUE(node.right > node.left && node.right < i);
+            }
+        }
+        begin = statement.end;
+    }
+    ASSERT_TRUE(begin == function->nodes.size());
+    ASSERT_TRUE(function->statements.back().isReturn());
+}
@@ -11,8 +11,9 @@ TEST(Syntax, simple) {
     sourceCode.emplace_back("RETURN 5");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    SyntaxAnalyser syntaxAnalyser(codeManager);
-    FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition();
+    Diagnostics diagnostics;
+    SyntaxAnalyser syntaxAnalyser(codeManager, diagnostics);
+    FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition().value();
 
     // all optionals empty
     assert(!program.constants.has_value());
@@ -22,7 +23,7 @@ TEST(Syntax, simple) {
     // no repeating statements
     CompoundStatement& compoundStatement = program.compoundStatement;
     StatementList& statementList = compoundStatement.statementList;
-    assert(statementList.repeating.get() == nullptr);
+    assert(statementList.repeating == nullptr);
 
     // correct optional
     Statement& statement = statementList.statement;
@@ -33,13 +34,13 @@ TEST(Syntax, simple) {
     AdditiveExpression& additiveExpression = returnAdditive.additiveExpression;
     assert(additiveExpression.whichOperator == AdditiveExpression::WhichOperator::None);
     assert(!additiveExpression.plusOrMinus.has_value());
-    assert(additiveExpression.additiveExpression.get() == nullptr);
+    assert(additiveExpression.additiveExpression == nullptr);
 
     // no operators and no additional multiplicative expressions
     MultiplicativeExpression& multiplicativeExpression = additiveExpression.multiplicativeExpression;
     assert(multiplicativeExpression.whichOperator == MultiplicativeExpression::WhichOperator::None);
     assert(!multiplicativeExpression.timesOrDivide.has_value());
-    assert(multiplicativeExpression.multiplicativeExpression.get() == nullptr);
+    assert(multiplicativeExpression.multiplicativeExpression == nullptr);
 
     // no operators
     UnaryExpression& unaryExpression = multiplicativeExpression.unaryExpression;
@@ -55,7 +56,7 @@ TEST(Syntax, simple) {
     // correct TerminalNode
     TerminalNode& terminalNode = primaryExpression.terminalNode.value();
     assert(terminalNode.type == TerminalNode::Type::Literal);
-    assert(terminalNode.codeFragment.getString() == "5");
+    assert(codeManager.getString(terminalNode.codeFragment) == "5");
 
 }
 
@@ -70,8 +71,9 @@ TEST(Syntax, bigTest) {
     sourceCode.emplace_back("\tRETURN density * volume");
     sourceCode.emplace_back("END.");
     CodeManager codeManager(sourceCode);
-    SyntaxAnalyser syntaxAnalyser(codeManager);
-    FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition();
+    Diagnostics diagnostics;
+    SyntaxAnalyser syntaxAnalyser(codeManager, diagnostics);
+    FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition().value();
 
     // all optionals not empty
     assert(program.constants.has_value());
@@ -81,44 +83,67 @@ TEST(Syntax, bigTest) {
     // correct DeclaratorList of Parameters
     ParameterDeclarations& parameterDeclarations = program.parameters.value();
     DeclaratorList& declaratorListParam = parameterDeclarations.declaratorList;
-    assert(declaratorListParam.identifier.codeFragment.getString() == "width");
-    assert(declaratorListParam.repeating->identifier.codeFragment.getString() == "height");
-    assert(declaratorListParam.repeating->next->identifier.codeFragment.getString() == "depth");
-    assert(declaratorListParam.repeating->next->next.get() == nullptr);
+    assert(codeManager.getString(declaratorListParam.identifier.codeFragment) == "width");
+    assert(codeManager.getString(declaratorListParam.repeating->identifier.codeFragment) == "height");
+    assert(codeManager.getString(declaratorListParam.repeating->next->identifier.codeFragment) == "depth");
+    assert(declaratorListParam.repeating->next->next == nullptr);
 
     // correct Variable Declarations
     VariableDeclarations& variableDeclarations = program.variables.value();
-    assert(variableDeclarations.declaratorList.identifier.codeFragment.getString() == "volume");
-    assert(variableDeclarations.declaratorList.repeating.get() == nullptr);
+    assert(codeManager.getString(variableDeclarations.declaratorList.identifier.codeFragment) == "volume");
+    assert(variableDeclarations.declaratorList.repeating == nullptr);
 
     // correct Constant Declarations
     ConstantDeclarations& constantDeclarations = program.constants.value();
     InitDeclaratorList& initDeclaratorList = constantDeclarations.initDeclaratorList;
-    assert(initDeclaratorList.repeating.get() == nullptr);
-    assert(initDeclaratorList.initDeclarator.identifier.codeFragment.getString() == "density");
-    assert(initDeclaratorList.initDeclarator.literal.codeFragment.getString() == "2400");
+    assert(initDeclaratorList.repeating == nullptr);
+    assert(codeManager.getString(initDeclaratorList.initDeclarator.identifier.codeFragment) == "density");
+    assert(codeManager.getString(initDeclaratorList.initDeclarator.literal.codeFragment) == "2400");
 
     // correct assignment expression
     CompoundStatement& compoundStatement = program.compoundStatement;
     AssignmentExpression& assignmentExpression = compoundStatement.statementList.statement.assignmentExpression.value();
-    assert(assignmentExpression.identifier.codeFragment.getString() == "volume");
+    assert(codeManager.getString(assignmentExpression.identifier.codeFragment) == "volume");
 
     // correct multiplicative expression in assignment expression
     MultiplicativeExpression& multiplicativeExpression1 = assignmentExpression.additiveExpression.multiplicativeExpression;
-    assert(multiplicativeExpression1.multiplicativeExpression->multiplicativeExpression->multiplicativeExpression.get() == nullptr);
+    assert(multiplicativeExpression1.multiplicativeExpression->multiplicativeExpression->multiplicativeExpression == nullptr);
     assert(multiplicativeExpression1.unaryExpression.primaryExpression.whichAlternative == PrimaryExpression::WhichAlternative::Identifier);
-    assert(multiplicativeExpression1.unaryExpression.primaryExpression.terminalNode.value().codeFragment.getString() == "width");
+    assert(codeManager.getString(multiplicativeExpression1.unaryExpression.primaryExpression.terminalNode.value().codeFragment) == "width");
     assert(multiplicativeExpression1.whichOperator == MultiplicativeExpression::WhichOperator::Multiplication);
     assert(multiplicativeExpression1.multiplicativeExpression->unaryExpression.primaryExpression.whichAlternative == PrimaryExpression::WhichAlternative::Identifier);
-    assert(multiplicativeExpression1.multiplicativeExpression->unaryExpression.primaryExpression.terminalNode.value().codeFragment.getString() == "height");
+    assert(codeManager.getString(multiplicativeExpression1.multiplicativeExpression->unaryExpression.primaryExpression.terminalNode.value().codeFragment) == "height");
     assert(multiplicativeExpression1.multiplicativeExpression->whichOperator == MultiplicativeExpression::WhichOperator::Multiplication);
-    assert(multiplicativeExpression1.multiplicativeExpression->multiplicativeExpression->unaryExpression.primaryExpression.terminalNode.value().codeFragment.getString() == "depth");
+    assert(codeManager.getString(multiplicativeExpression1.multiplicativeExpression->multiplicativeExpression->unaryExpression.primaryExpression.terminalNode.value().codeFragment) == "depth");
 
     // correct multiplicative expression in RETURN expression
     MultiplicativeExpression& multiplicativeExpression2 = compoundStatement.statementList.repeating->statement.returnAdditive.value().additiveExpression.multiplicativeExpression;
     assert(multiplicativeExpression2.whichOperator == MultiplicativeExpression::WhichOperator::Multiplication);
     assert(multiplicativeExpression2.unaryExpression.primaryExpression.whichAlternative == PrimaryExpression::WhichAlternative::Identifier);
-    assert(multiplicativeExpression2.unaryExpression.primaryExpression.terminalNode.value().codeFragment.getString() == "density");
+    assert(codeManager.getString(multiplicativeExpression2.unaryExpression.primaryExpression.terminalNode.value().codeFragment) == "density");
     assert(multiplicativeExpression2.multiplicativeExpression->unaryExpression.primaryExpression.whichAlternative == PrimaryExpression::WhichAlternative::Identifier);
-    assert(multiplicativeExpression2.multiplicativeExpression->unaryExpression.primaryExpression.terminalNode.value().codeFragment.getString() == "volume");
+    assert(codeManager.getString(multiplicativeExpression2.multiplicativeExpression->unaryExpression.primaryExpression.terminalNode.value().codeFragment) == "volume");
+}
+
+TEST(Syntax, longStatementList) {
+    std::vector<std::string> lines;
+    lines.emplace_back("VAR a;");
+    lines.emplace_back("BEGIN");
+    for(unsigned i = 0; i < 1000; i++) {
+        lines.emplace_back("a := a + 1;");
+    }
+    lines.emplace_back("RETURN a");
+    lines.emplace_back("END.");
+    std::vector<std::string_view> sourceCode(lines.begin(), lines.end());
+    CodeManager codeManager(sourceCode);
+    Diagnostics diagnostics;
+    SyntaxAnalyser syntaxAnalyser(codeManager, diagnostics);
+    FunctionDefinition program = syntaxAnalyser.parseFunctionDefinition().value();
+
+    // all statements are in the linked list
+    unsigned count = 1;
+    for(StatementList::Repeating* repeating = program.compoundStatement.statementList.repeating; repeating; repeating = repeating->next) {
+        count++;
+    }
+    assert(count == 1001);
 }